@@ -0,0 +1,182 @@
+#include <chrono>
+#include <complex>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "polynomial.h"
+#include "polynomial_text.h"
+#include "polynomial_compensated.h"
+
+// Benchmarks for the Polynomial operations and text conversion across
+// coefficient types, sizes and sparsity levels. Results are written to
+// stdout as CSV (default) or JSON for tracking regressions between
+// releases.
+//
+// Usage: bench [--format csv|json] [--quick]
+
+using namespace std;
+
+struct Result {
+    string operation;
+    string type;
+    size_t terms;
+    double density;
+    size_t iterations;
+    double ns_per_op;
+};
+
+// Keeps the benchmarked computations from being optimized away
+static volatile size_t sink;
+
+template<typename T> T random_coefficient(mt19937 &rng) {
+    uniform_int_distribution<int> d(1, 100);
+    return T(d(rng)) / T(7);
+}
+
+template<> int random_coefficient<int>(mt19937 &rng) {
+    uniform_int_distribution<int> d(1, 100);
+    return d(rng);
+}
+
+template<> complex<float> random_coefficient<complex<float>>(mt19937 &rng) {
+    uniform_int_distribution<int> d(1, 100);
+    return complex<float>(d(rng) / 7.f, d(rng) / 7.f);
+}
+
+// Polynomial with `terms` terms whose exponents are spread over
+// terms / density slots
+template<typename T>
+Polynomial<T> make_polynomial(size_t terms, double density, unsigned seed) {
+    mt19937 rng(seed);
+    unsigned span = unsigned(terms / density);
+    uniform_int_distribution<unsigned> exponent(0, span - 1);
+    Polynomial<T> p;
+    while (p.length() < terms)
+        p.add_term(exponent(rng), random_coefficient<T>(rng));
+    return p;
+}
+
+// Run op repeatedly until at least min_time has passed
+template<typename Op>
+pair<size_t, double> measure(Op op, chrono::duration<double> min_time) {
+    using clock = chrono::steady_clock;
+    size_t iterations = 0;
+    auto start = clock::now();
+    chrono::duration<double> elapsed(0);
+    while (elapsed < min_time) {
+        op();
+        iterations++;
+        elapsed = clock::now() - start;
+    }
+    return {iterations, chrono::duration<double, nano>(elapsed).count() / iterations};
+}
+
+template<typename T>
+void bench_type(const string &type, const vector<size_t> &sizes,
+                chrono::duration<double> min_time, vector<Result> &results) {
+    const double densities[] = {1.0, 0.1, 0.01};
+
+    for (size_t terms : sizes) {
+        for (double density : densities) {
+            auto p = make_polynomial<T>(terms, density, 1);
+            auto q = make_polynomial<T>(terms, density, 2);
+            auto p_copy = p;
+            T point = T(1) - T(1) / T(terms + 1);
+
+            auto record = [&](const string &operation, pair<size_t, double> m) {
+                results.push_back({operation, type, terms, density, m.first, m.second});
+            };
+
+            record("operator+", measure([&]() { sink = (p + q).length(); }, min_time));
+            record("operator==", measure([&]() { sink = (p == p_copy); }, min_time));
+            record("operator()", measure([&]() { sink = p(point) != T(); }, min_time));
+            record("evaluate_with_derivatives", measure([&]() {
+                T values[3];
+                p.evaluate_with_derivatives(point, 2, values);
+                sink = values[2] != T();
+            }, min_time));
+            if constexpr (std::is_floating_point<T>::value)
+                record("evaluate_compensated", measure([&]() { sink = evaluate_compensated(p, point) != T(); }, min_time));
+            record("differentiate", measure([&]() { sink = p.differentiate().length(); }, min_time));
+            record("print", measure([&]() {
+                ostringstream os;
+                p.print(os);
+                sink = os.tellp();
+            }, min_time));
+
+            PolynomialFormatter<T> formatter;
+            string formatted;
+            record("format", measure([&]() {
+                formatted.clear();
+                formatter.append(formatted, p);
+                sink = formatted.size();
+            }, min_time));
+
+            ostringstream printed;
+            p.print(printed);
+            string text = printed.str();
+            record("parse", measure([&]() { sink = parse<T>(text).length(); }, min_time));
+
+            // Quadratic cost, keep operands moderate
+            if (terms <= 1000)
+                record("operator*", measure([&]() { sink = (p * q).length(); }, min_time));
+        }
+    }
+}
+
+void write_csv(ostream &os, const vector<Result> &results) {
+    os << "operation,type,terms,density,iterations,ns_per_op\n";
+    for (auto &r : results)
+        os << r.operation << "," << r.type << "," << r.terms << "," << r.density << ","
+           << r.iterations << "," << r.ns_per_op << "\n";
+}
+
+void write_json(ostream &os, const vector<Result> &results) {
+    os << "[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto &r = results[i];
+        os << "  {\"operation\": \"" << r.operation << "\", \"type\": \"" << r.type
+           << "\", \"terms\": " << r.terms << ", \"density\": " << r.density
+           << ", \"iterations\": " << r.iterations << ", \"ns_per_op\": " << r.ns_per_op
+           << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "]\n";
+}
+
+int main(int argc, char **argv) {
+    string format = "csv";
+    bool quick = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format = argv[++i];
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else {
+            cerr << "Usage: " << argv[0] << " [--format csv|json] [--quick]" << endl;
+            return 1;
+        }
+    }
+    if (format != "csv" && format != "json") {
+        cerr << "Unknown format " << format << endl;
+        return 1;
+    }
+
+    vector<size_t> sizes = quick ? vector<size_t>{10, 100}
+                                 : vector<size_t>{10, 100, 1000, 10000};
+    chrono::duration<double> min_time(quick ? 0.005 : 0.1);
+
+    vector<Result> results;
+    bench_type<int>("int", sizes, min_time, results);
+    bench_type<float>("float", sizes, min_time, results);
+    bench_type<double>("double", sizes, min_time, results);
+    bench_type<complex<float>>("complex<float>", sizes, min_time, results);
+
+    if (format == "json")
+        write_json(cout, results);
+    else
+        write_csv(cout, results);
+}
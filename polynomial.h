@@ -1,10 +1,22 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <iosfwd>
 #include <map>
+#include <memory_resource>
 #include <utility> // std::pair
 #include <string>
 #include <complex>
 
+#ifdef POLYNOMIAL_INSTRUMENTATION
+#include "polynomial_stats.h"
+#define POLYNOMIAL_INSTRUMENT(operation, terms) \
+    PolynomialOperationTimer polynomial_operation_timer(PolynomialOperation::operation, terms)
+#else
+#define POLYNOMIAL_INSTRUMENT(operation, terms)
+#endif
+
 // Helper functions for printing
 template<typename T> bool tSign(T t) {
     if (t < 0) return true;
@@ -25,28 +37,196 @@ std::complex<U> tAbs(std::complex<U> t) {
     return t;
 }
 
+// Memory resource used by polynomials unless overridden. Instrumented
+// builds count allocations passing through it.
+inline std::pmr::memory_resource *polynomial_default_resource() {
+#ifdef POLYNOMIAL_INSTRUMENTATION
+    return polynomial_counting_resource();
+#else
+    return std::pmr::get_default_resource();
+#endif
+}
+
+// Memory resource for the terms of polynomials constructed on this thread.
+// Defaults to polynomial_default_resource() unless overridden by a
+// PolynomialResourceScope.
+inline std::pmr::memory_resource *&polynomial_resource_override() {
+    static thread_local std::pmr::memory_resource *resource = nullptr;
+    return resource;
+}
+
+inline std::pmr::memory_resource *polynomial_memory_resource() {
+    std::pmr::memory_resource *resource = polynomial_resource_override();
+    return resource ? resource : polynomial_default_resource();
+}
+
+// Makes polynomials constructed on this thread allocate from `resource`
+// for the lifetime of the scope. Scopes nest.
+class PolynomialResourceScope {
+ private:
+    std::pmr::memory_resource *previous;
+
+ public:
+    explicit PolynomialResourceScope(std::pmr::memory_resource *resource)
+        : previous(polynomial_resource_override()) {
+        polynomial_resource_override() = resource;
+    }
+
+    PolynomialResourceScope(PolynomialResourceScope const &) = delete;
+    PolynomialResourceScope &operator= (PolynomialResourceScope const &) = delete;
+
+    ~PolynomialResourceScope() {
+        polynomial_resource_override() = previous;
+    }
+};
+
+// Evaluate a sequence of (exponent, coefficient) terms in ascending order
+// of exponent at a point, computing the powers of the point incrementally
+template<typename Iterator, typename U>
+U evaluate_terms(Iterator first, Iterator last, U value) {
+    U result = U();
+    U tmp = value;
+    unsigned tmp_exponent = 1;
+
+    for (; first != last; ++first) {
+        auto term = *first;
+        unsigned exponent = term.first;
+        auto coefficient = term.second;
+
+        if (exponent == 0) {
+            result += coefficient;
+        } else if (exponent == 1) {
+            result += value * coefficient;
+        } else {
+            while (tmp_exponent < exponent) {
+                tmp *= value;
+                tmp_exponent += 1;
+            }
+            result += tmp * coefficient;
+        }
+    }
+
+    return result;
+}
+
+// Evaluate a sequence of terms in descending order of exponent and its
+// first k derivatives at a point, writing p^(j)(value) to values[j].
+// Horner's rule is applied to the value and the derivatives in the same
+// pass, stepping through the gaps between exponents.
+template<typename Iterator, typename U>
+void evaluate_terms_with_derivatives(Iterator first, Iterator last, U value, unsigned k, U *values) {
+    std::fill(values, values + k + 1, U());
+    if (first == last)
+        return;
+
+    unsigned exponent = first->first;
+    values[0] += first->second;
+    auto step = [&]() {
+        for (unsigned j = k; j > 0; --j)
+            values[j] = values[j] * value + values[j - 1];
+        values[0] *= value;
+        exponent -= 1;
+    };
+
+    for (++first; first != last; ++first) {
+        while (exponent > first->first)
+            step();
+        values[0] += first->second;
+    }
+    while (exponent > 0)
+        step();
+
+    // Horner's rule leaves p^(j)(value) / j! in values[j]
+    U factorial = U(1);
+    for (unsigned j = 2; j <= k; ++j) {
+        factorial *= U(j);
+        values[j] *= factorial;
+    }
+}
+
+// The same for count points at once. values is laid out by derivative,
+// with p^(j)(points[i]) at values[j * count + i], so that the inner loops
+// run over contiguous points and vectorize.
+template<typename Iterator, typename U>
+void evaluate_terms_with_derivatives(Iterator first, Iterator last, const U *points, size_t count,
+                                     unsigned k, U *values) {
+    std::fill(values, values + (k + 1) * count, U());
+    if (first == last)
+        return;
+
+    unsigned exponent = first->first;
+    auto add = [&](U coefficient) {
+        for (size_t i = 0; i < count; ++i)
+            values[i] += coefficient;
+    };
+    auto step = [&]() {
+        for (unsigned j = k; j > 0; --j) {
+            U *current = values + j * count;
+            const U *lower = values + (j - 1) * count;
+            for (size_t i = 0; i < count; ++i)
+                current[i] = current[i] * points[i] + lower[i];
+        }
+        for (size_t i = 0; i < count; ++i)
+            values[i] *= points[i];
+        exponent -= 1;
+    };
+
+    add(U(first->second));
+    for (++first; first != last; ++first) {
+        while (exponent > first->first)
+            step();
+        add(U(first->second));
+    }
+    while (exponent > 0)
+        step();
+
+    U factorial = U(1);
+    for (unsigned j = 2; j <= k; ++j) {
+        factorial *= U(j);
+        for (size_t i = 0; i < count; ++i)
+            values[j * count + i] *= factorial;
+    }
+}
+
 template<typename T>
 class Polynomial {
+ public:
+    typedef std::pmr::polymorphic_allocator<std::pair<const unsigned, T>> allocator_type;
+
  private:
-    std::map<unsigned, T> terms;
+    std::pmr::map<unsigned, T> terms{allocator_type(polynomial_memory_resource())};
 
  public:
     Polynomial() = default;
 
-    Polynomial(Polynomial<T> const &p) : terms{p.terms} 
+    explicit Polynomial(allocator_type allocator) : terms(allocator)
+    {}
+
+    // Copies allocate from the current thread's polynomial memory resource
+    Polynomial(Polynomial<T> const &p) : terms(p.terms, allocator_type(polynomial_memory_resource()))
+    {}
+
+    Polynomial(Polynomial<T> const &p, allocator_type allocator) : terms(p.terms, allocator)
     {}
 
+    // Moved-to polynomials keep the memory resource of the source, while
+    // assignment keeps the resource of the target
+    Polynomial(Polynomial<T> &&p) = default;
+    Polynomial<T> &operator= (Polynomial<T> const &p) = default;
+    Polynomial<T> &operator= (Polynomial<T> &&p) = default;
+
     explicit Polynomial(std::map<unsigned, T> terms) {
         for (auto &p : terms) {
             if (p.second != T()) {
-                this->terms[p.first] = p.second;
+                this->terms.emplace_hint(this->terms.end(), p.first, p.second);
             }
         }
     }
 
     // Enable implicit conversion from coefficient type to constant term
-    Polynomial(T value) : terms{{0,value}} 
-    {}
+    Polynomial(T value) {
+        terms.emplace(0, value);
+    }
 
     // Construct a linear term / variable for convenience
     static Polynomial<T> LinearTerm(T coefficient = T(1)) {
@@ -55,49 +235,178 @@ class Polynomial {
         return p;
     }
 
-    size_t length() {
+    typedef typename std::pmr::map<unsigned, T>::const_iterator const_iterator;
+
+    allocator_type get_allocator() const {
+        return terms.get_allocator();
+    }
+
+    size_t length() const {
         return terms.size();
     }
 
-    T coefficient(unsigned term) {
-        if (terms.count(term) != 0) {
-            return terms[term];
+    // Highest exponent with a nonzero coefficient, 0 for the zero polynomial
+    unsigned degree() const {
+        return terms.empty() ? 0 : terms.rbegin()->first;
+    }
+
+    T coefficient(unsigned term) const {
+        auto it = terms.find(term);
+        if (it != terms.end()) {
+            return it->second;
         } else {
             return T();
         }
     }
 
+    // Read-only iteration over (exponent, coefficient) pairs in ascending
+    // order of exponent
+    const_iterator begin() const {
+        return terms.begin();
+    }
+
+    const_iterator end() const {
+        return terms.end();
+    }
+
+    // Accumulate a term into the polynomial. Appending terms in ascending
+    // order of exponent takes amortized constant time.
+    void add_term(unsigned exponent, T coefficient) {
+        accumulate(terms.end(), exponent, coefficient);
+    }
+
+    // In-place arithmetic. These reuse the storage of the left operand
+    // and insert new terms next to their neighbours, which makes merging
+    // a sorted sequence of terms linear in the number of terms. An operand
+    // aliasing the polynomial itself is updated term by term instead, since
+    // accumulating would erase terms it is iterating over.
+    Polynomial<T> &operator+= (const Polynomial &rhs) {
+        if (&rhs == this) {
+            update_coefficients([](const T &c) { return c + c; });
+            return *this;
+        }
+        auto hint = terms.begin();
+        for (auto &term : rhs.terms)
+            hint = accumulate(hint, term.first, term.second);
+        return *this;
+    }
+
+    Polynomial<T> &operator-= (const Polynomial &rhs) {
+        if (&rhs == this) {
+            terms.clear();
+            return *this;
+        }
+        auto hint = terms.begin();
+        for (auto &term : rhs.terms)
+            hint = accumulate(hint, term.first, -term.second);
+        return *this;
+    }
+
+    Polynomial<T> &operator*= (const Polynomial &rhs) {
+        if (is_constant(rhs)) {
+            scale(rhs.terms.begin()->second);
+        } else {
+            *this = *this * rhs;
+        }
+        return *this;
+    }
+
+    // Fused p += a*q without creating a temporary for a*q
+    Polynomial<T> &add_scaled(T a, const Polynomial &q) {
+        if (&q == this) {
+            update_coefficients([&a](const T &c) { return c + a * c; });
+            return *this;
+        }
+        auto hint = terms.begin();
+        for (auto &term : q.terms)
+            hint = accumulate(hint, term.first, a * term.second);
+        return *this;
+    }
+
     // Declaration as non-templated friend function to allow 
     // implicit conversions from numeric types.
     // See https://web.mst.edu/~nmjxv3/articles/templates.html
+    //
+    // The overloads taking rvalue references work in the storage of a
+    // temporary operand, so chained expressions such as
+    // 4.5*x*x - 7.1*x + 0.5 don't copy the intermediate results.
     friend Polynomial operator+ (const Polynomial &lhs, const Polynomial &rhs) {
+        POLYNOMIAL_INSTRUMENT(Add, lhs.terms.size() + rhs.terms.size());
         Polynomial<T> result(lhs);
-        for (auto &term : rhs.terms) {
-            unsigned exponent = term.first;
-            T coefficient = term.second;
+        result += rhs;
+        return result;
+    }
 
-            result.terms[exponent] += coefficient;
+    friend Polynomial operator+ (Polynomial &&lhs, const Polynomial &rhs) {
+        POLYNOMIAL_INSTRUMENT(Add, lhs.terms.size() + rhs.terms.size());
+        lhs += rhs;
+        return std::move(lhs);
+    }
 
-            // Remove zero-coefficient terms
-            if (result.terms[exponent] == T()) 
-                result.terms.erase(exponent);
-        }
-        return result;
+    friend Polynomial operator+ (const Polynomial &lhs, Polynomial &&rhs) {
+        POLYNOMIAL_INSTRUMENT(Add, lhs.terms.size() + rhs.terms.size());
+        rhs += lhs;
+        return std::move(rhs);
+    }
+
+    friend Polynomial operator+ (Polynomial &&lhs, Polynomial &&rhs) {
+        POLYNOMIAL_INSTRUMENT(Add, lhs.terms.size() + rhs.terms.size());
+        lhs += rhs;
+        return std::move(lhs);
     }
 
-    Polynomial<T> operator- () const {
+    Polynomial<T> operator- () const & {
         Polynomial<T> result(*this);
-        for (auto &p : result.terms) {
-            p.second = -p.second;
-        }
+        result.negate();
         return result;
     }
 
+    Polynomial<T> operator- () && {
+        negate();
+        return std::move(*this);
+    }
+
     friend Polynomial operator- (const Polynomial &lhs, const Polynomial &rhs) {
-        return lhs + -rhs;
+        Polynomial<T> result(lhs);
+        result -= rhs;
+        return result;
+    }
+
+    friend Polynomial operator- (Polynomial &&lhs, const Polynomial &rhs) {
+        lhs -= rhs;
+        return std::move(lhs);
+    }
+
+    friend Polynomial operator- (const Polynomial &lhs, Polynomial &&rhs) {
+        rhs.negate();
+        rhs += lhs;
+        return std::move(rhs);
+    }
+
+    friend Polynomial operator- (Polynomial &&lhs, Polynomial &&rhs) {
+        lhs -= rhs;
+        return std::move(lhs);
     }
 
     friend Polynomial operator* (const Polynomial &lhs, const Polynomial &rhs) {
+        POLYNOMIAL_INSTRUMENT(Multiply, lhs.terms.size() + rhs.terms.size());
+
+        // Products with a single term only shift and scale the other
+        // operand, which appends terms in order
+        if (lhs.terms.size() == 1 || rhs.terms.size() == 1) {
+            Polynomial<T> result;
+            if (lhs.terms.size() == 1) {
+                auto &term = *lhs.terms.begin();
+                for (auto &p2 : rhs.terms)
+                    result.add_term(term.first + p2.first, term.second * p2.second);
+            } else {
+                auto &term = *rhs.terms.begin();
+                for (auto &p1 : lhs.terms)
+                    result.add_term(p1.first + term.first, p1.second * term.second);
+            }
+            return result;
+        }
+
         Polynomial<T> result;
         for (auto &p1 : lhs.terms) {
             unsigned exponent_1 = p1.first;
@@ -120,7 +429,31 @@ class Polynomial {
         return result;
     }
 
-    Polynomial<T> differentiate() {
+    friend Polynomial operator* (Polynomial &&lhs, const Polynomial &rhs) {
+        if (is_constant(rhs)) {
+            POLYNOMIAL_INSTRUMENT(Multiply, lhs.terms.size() + 1);
+            lhs.scale(rhs.terms.begin()->second);
+            return std::move(lhs);
+        }
+        return static_cast<const Polynomial &>(lhs) * rhs;
+    }
+
+    friend Polynomial operator* (const Polynomial &lhs, Polynomial &&rhs) {
+        if (is_constant(lhs)) {
+            POLYNOMIAL_INSTRUMENT(Multiply, rhs.terms.size() + 1);
+            rhs.scale_left(lhs.terms.begin()->second);
+            return std::move(rhs);
+        }
+        return lhs * static_cast<const Polynomial &>(rhs);
+    }
+
+    friend Polynomial operator* (Polynomial &&lhs, Polynomial &&rhs) {
+        return std::move(lhs) * static_cast<const Polynomial &>(rhs);
+    }
+
+    Polynomial<T> differentiate() const {
+        POLYNOMIAL_INSTRUMENT(Differentiate, terms.size());
+
         Polynomial<T> result;
         for (auto &term : terms) {
             unsigned exponent = term.first;
@@ -144,7 +477,7 @@ class Polynomial {
         return !(*this == other);
     }
 
-    void print(std::ostream& os, std::string variable="x") const {
+    void print(std::ostream& os, const std::string &variable="x") const {
         // Handle zero polynomial
         if (terms.size() == 0) {
             os << T();
@@ -173,29 +506,79 @@ class Polynomial {
 
     // evaluate the polynomial at a point
     template<typename U>
-    U operator() (U value) {
-        U result = U();
-        U tmp = value;
-        unsigned tmp_exponent = 1;
+    U operator() (U value) const {
+        POLYNOMIAL_INSTRUMENT(Evaluate, terms.size());
 
-        for (auto &term : terms) {
-            unsigned exponent = term.first;
-            T coefficient = term.second;
+        return evaluate_terms(terms.begin(), terms.end(), value);
+    }
 
-            if (exponent == 0) {
-                result += coefficient;
-            } else if (exponent == 1) {
-                result += value * coefficient;
-            } else {
-                while (tmp_exponent < exponent) {
-                    tmp *= value;
-                    tmp_exponent += 1;
-                }
-                result += tmp * coefficient;
-            }
+    // evaluate the polynomial and its first k derivatives at a point,
+    // writing the (k + 1) results to values
+    template<typename U>
+    void evaluate_with_derivatives(U value, unsigned k, U *values) const {
+        POLYNOMIAL_INSTRUMENT(Evaluate, terms.size());
+
+        evaluate_terms_with_derivatives(terms.rbegin(), terms.rend(), value, k, values);
+    }
+
+    template<unsigned K, typename U>
+    std::array<U, K + 1> evaluate_with_derivatives(U value) const {
+        std::array<U, K + 1> values;
+        evaluate_with_derivatives(value, K, values.data());
+        return values;
+    }
+
+    // evaluate the polynomial and its first k derivatives at count points,
+    // writing p^(j)(points[i]) to values[j * count + i]
+    template<typename U>
+    void evaluate_with_derivatives(const U *points, size_t count, unsigned k, U *values) const {
+        POLYNOMIAL_INSTRUMENT(Evaluate, terms.size() * count);
+
+        evaluate_terms_with_derivatives(terms.rbegin(), terms.rend(), points, count, k, values);
+    }
+
+ private:
+    typedef typename std::pmr::map<unsigned, T>::iterator iterator;
+
+    // Add coefficient to the term with the given exponent, using hint as
+    // the expected position. Returns the position following the term.
+    iterator accumulate(iterator hint, unsigned exponent, T coefficient) {
+        auto it = terms.try_emplace(hint, exponent, T());
+        it->second += coefficient;
+
+        // Remove zero-coefficient terms
+        if (it->second == T())
+            return terms.erase(it);
+        return std::next(it);
+    }
+
+    void negate() {
+        for (auto &p : terms) {
+            p.second = -p.second;
+        }
+    }
+
+    // Multiply every coefficient by a constant from the right (scale) or
+    // from the left (scale_left), matching the operand order of operator*
+    void scale(T factor) {
+        update_coefficients([&factor](const T &c) { return c * factor; });
+    }
+
+    void scale_left(T factor) {
+        update_coefficients([&factor](const T &c) { return factor * c; });
+    }
+
+    // Replace every coefficient c by f(c), removing those that become zero
+    template<typename F>
+    void update_coefficients(F f) {
+        for (auto it = terms.begin(); it != terms.end(); ) {
+            it->second = f(it->second);
+            it = it->second == T() ? terms.erase(it) : std::next(it);
         }
+    }
 
-        return result;
+    static bool is_constant(const Polynomial &p) {
+        return p.terms.size() == 1 && p.terms.begin()->first == 0;
     }
 };
 
@@ -0,0 +1,437 @@
+#pragma once
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <ostream>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "polynomial.h"
+
+// Compact binary format for polynomials.
+//
+// A record is a fixed-size header followed by the exponent array and the
+// coefficient array, in ascending order of exponent:
+//
+//   BinaryHeader                 24 bytes
+//   exponents                    length * exponent width bytes
+//   padding                      to a multiple of alignof(T)
+//   coefficients                 length * sizeof(T) bytes
+//   padding                      to a multiple of 8
+//
+// Exponents are stored as absolute 32-bit values, or as differences
+// between consecutive exponents in 8 or 16 bits when the gaps are small
+// enough. The first delta is the first exponent itself. Values are stored
+// in the byte order of the writing machine, which is checked on load.
+//
+// PolynomialView reads a record directly from memory without copying it.
+// Construction validates the header and checks in one pass that the
+// exponents increase strictly; terms are decoded on the fly afterwards.
+
+struct BinaryHeader {
+    char magic[4];
+    uint16_t byte_order;
+    uint8_t version;
+    uint8_t exponent_encoding;
+    uint8_t coefficient_kind;
+    uint8_t coefficient_size;
+    uint16_t reserved;
+    uint32_t degree;
+    uint64_t length;
+};
+
+static_assert(sizeof(BinaryHeader) == 24, "unexpected BinaryHeader padding");
+
+enum class ExponentEncoding : uint8_t {
+    Absolute32 = 0,
+    Delta8 = 1,
+    Delta16 = 2
+};
+
+class BinaryFormatError : public std::runtime_error {
+ public:
+    explicit BinaryFormatError(const std::string &what) : std::runtime_error(what)
+    {}
+};
+
+namespace detail {
+
+const char binary_magic[4] = {'P', 'O', 'L', 'Y'};
+const uint16_t binary_byte_order = 0x0102;
+const uint8_t binary_version = 1;
+
+// Coefficient type tags stored in the header along with sizeof(T)
+template<typename T, typename Enable = void>
+struct CoefficientKind;
+
+template<typename T>
+struct CoefficientKind<T, std::enable_if_t<std::is_integral<T>::value && std::is_signed<T>::value>> {
+    static const uint8_t value = 1;
+};
+
+template<typename T>
+struct CoefficientKind<T, std::enable_if_t<std::is_integral<T>::value && std::is_unsigned<T>::value>> {
+    static const uint8_t value = 2;
+};
+
+template<typename T>
+struct CoefficientKind<T, std::enable_if_t<std::is_floating_point<T>::value>> {
+    static const uint8_t value = 3;
+};
+
+template<typename U>
+struct CoefficientKind<std::complex<U>, std::enable_if_t<std::is_floating_point<U>::value>> {
+    static const uint8_t value = 4;
+};
+
+inline size_t align_up(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+inline size_t exponent_width(ExponentEncoding encoding) {
+    switch (encoding) {
+        case ExponentEncoding::Delta8: return 1;
+        case ExponentEncoding::Delta16: return 2;
+        default: return 4;
+    }
+}
+
+// Unaligned load of a trivially copyable value
+template<typename V>
+V load(const char *p) {
+    V value;
+    std::memcpy(&value, p, sizeof(V));
+    return value;
+}
+
+template<typename T>
+ExponentEncoding choose_encoding(const Polynomial<T> &p) {
+    unsigned max_delta = 0, previous = 0;
+    for (auto &term : p) {
+        max_delta = std::max(max_delta, term.first - previous);
+        previous = term.first;
+    }
+    if (max_delta <= 0xff)
+        return ExponentEncoding::Delta8;
+    if (max_delta <= 0xffff)
+        return ExponentEncoding::Delta16;
+    return ExponentEncoding::Absolute32;
+}
+
+} // namespace detail
+
+// Size in bytes of the binary record of p
+template<typename T>
+size_t binary_size(const Polynomial<T> &p) {
+    size_t width = detail::exponent_width(detail::choose_encoding(p));
+    size_t offset = sizeof(BinaryHeader) + p.length() * width;
+    offset = detail::align_up(offset, alignof(T)) + p.length() * sizeof(T);
+    return detail::align_up(offset, 8);
+}
+
+// Write the binary record of p to out, which must hold binary_size(p) bytes
+template<typename T>
+void write_binary(const Polynomial<T> &p, char *out) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "binary format requires trivially copyable coefficients");
+
+    ExponentEncoding encoding = detail::choose_encoding(p);
+    size_t width = detail::exponent_width(encoding);
+    size_t size = binary_size(p);
+    std::memset(out, 0, size);
+
+    BinaryHeader header;
+    std::memcpy(header.magic, detail::binary_magic, 4);
+    header.byte_order = detail::binary_byte_order;
+    header.version = detail::binary_version;
+    header.exponent_encoding = uint8_t(encoding);
+    header.coefficient_kind = detail::CoefficientKind<T>::value;
+    header.coefficient_size = uint8_t(sizeof(T));
+    header.reserved = 0;
+    header.degree = p.degree();
+    header.length = p.length();
+    std::memcpy(out, &header, sizeof(header));
+
+    char *exponents = out + sizeof(BinaryHeader);
+    char *coefficients = out + detail::align_up(sizeof(BinaryHeader) + p.length() * width, alignof(T));
+    unsigned previous = 0;
+    for (auto &term : p) {
+        uint32_t exponent = term.first;
+        if (encoding == ExponentEncoding::Delta8) {
+            uint8_t delta = uint8_t(exponent - previous);
+            std::memcpy(exponents, &delta, 1);
+        } else if (encoding == ExponentEncoding::Delta16) {
+            uint16_t delta = uint16_t(exponent - previous);
+            std::memcpy(exponents, &delta, 2);
+        } else {
+            std::memcpy(exponents, &exponent, 4);
+        }
+        previous = exponent;
+        exponents += width;
+
+        std::memcpy(coefficients, &term.second, sizeof(T));
+        coefficients += sizeof(T);
+    }
+}
+
+// Append the binary record of p to a buffer
+template<typename T>
+void write_binary(const Polynomial<T> &p, std::vector<char> &out) {
+    size_t offset = out.size();
+    out.resize(offset + binary_size(p));
+    write_binary(p, out.data() + offset);
+}
+
+template<typename T>
+void write_binary(const Polynomial<T> &p, std::ostream &os) {
+    std::vector<char> buffer;
+    write_binary(p, buffer);
+    os.write(buffer.data(), buffer.size());
+}
+
+// Read-only polynomial backed by a binary record in memory. The record,
+// including the order of its exponents, is validated on construction in
+// time linear in its length, after which terms are decoded on the fly
+// while iterating. The memory must outlive the view.
+template<typename T>
+class PolynomialView {
+ private:
+    const char *data = nullptr;
+    BinaryHeader header;
+    const char *exponents = nullptr;
+    const char *coefficients = nullptr;
+
+    // Exponents must increase strictly, without overflowing 32 bits, and
+    // end at the degree in the header
+    void validate_exponents() const {
+        ExponentEncoding encoding = this->encoding();
+        size_t width = detail::exponent_width(encoding);
+        uint64_t exponent = 0;
+        for (size_t i = 0; i < header.length; ++i) {
+            const char *p = exponents + i * width;
+            uint64_t next;
+            if (encoding == ExponentEncoding::Delta8)
+                next = exponent + detail::load<uint8_t>(p);
+            else if (encoding == ExponentEncoding::Delta16)
+                next = exponent + detail::load<uint16_t>(p);
+            else
+                next = detail::load<uint32_t>(p);
+            if (i > 0 && next <= exponent)
+                throw BinaryFormatError("binary polynomial: exponents not increasing");
+            if (next > UINT32_MAX)
+                throw BinaryFormatError("binary polynomial: exponent overflow");
+            exponent = next;
+        }
+        if (header.degree != exponent)
+            throw BinaryFormatError("binary polynomial: degree doesn't match exponents");
+    }
+
+ public:
+    // Iterates over (exponent, coefficient) pairs in ascending order
+    class const_iterator {
+     private:
+        const char *exponent_ptr;
+        const char *coefficient_ptr;
+        size_t remaining;
+        ExponentEncoding encoding;
+        unsigned exponent;
+
+        void decode() {
+            if (encoding == ExponentEncoding::Delta8)
+                exponent += detail::load<uint8_t>(exponent_ptr);
+            else if (encoding == ExponentEncoding::Delta16)
+                exponent += detail::load<uint16_t>(exponent_ptr);
+            else
+                exponent = detail::load<uint32_t>(exponent_ptr);
+        }
+
+     public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef std::pair<unsigned, T> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const value_type *pointer;
+        typedef value_type reference;
+
+        const_iterator(const char *exponent_ptr, const char *coefficient_ptr,
+                       size_t remaining, ExponentEncoding encoding)
+            : exponent_ptr(exponent_ptr), coefficient_ptr(coefficient_ptr),
+              remaining(remaining), encoding(encoding), exponent(0) {
+            if (remaining > 0)
+                decode();
+        }
+
+        value_type operator* () const {
+            return {exponent, detail::load<T>(coefficient_ptr)};
+        }
+
+        const_iterator &operator++ () {
+            exponent_ptr += detail::exponent_width(encoding);
+            coefficient_ptr += sizeof(T);
+            if (--remaining > 0)
+                decode();
+            return *this;
+        }
+
+        const_iterator operator++ (int) {
+            const_iterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        bool operator== (const const_iterator &other) const {
+            return coefficient_ptr == other.coefficient_ptr;
+        }
+
+        bool operator!= (const const_iterator &other) const {
+            return coefficient_ptr != other.coefficient_ptr;
+        }
+    };
+
+    PolynomialView() {
+        std::memset(&header, 0, sizeof(header));
+    }
+
+    // Wrap the record at the start of a buffer of `size` bytes
+    PolynomialView(const void *buffer, size_t size) : data(static_cast<const char *>(buffer)) {
+        if (size < sizeof(BinaryHeader))
+            throw BinaryFormatError("binary polynomial: truncated header");
+        std::memcpy(&header, data, sizeof(header));
+
+        if (std::memcmp(header.magic, detail::binary_magic, 4) != 0)
+            throw BinaryFormatError("binary polynomial: bad magic");
+        if (header.byte_order != detail::binary_byte_order)
+            throw BinaryFormatError("binary polynomial: byte order mismatch");
+        if (header.version != detail::binary_version)
+            throw BinaryFormatError("binary polynomial: unsupported version");
+        if (header.coefficient_kind != detail::CoefficientKind<T>::value ||
+            header.coefficient_size != sizeof(T))
+            throw BinaryFormatError("binary polynomial: coefficient type mismatch");
+        if (header.exponent_encoding > uint8_t(ExponentEncoding::Delta16))
+            throw BinaryFormatError("binary polynomial: unknown exponent encoding");
+        if (header.length > size / sizeof(T))
+            throw BinaryFormatError("binary polynomial: truncated data");
+        if (size < size_bytes())
+            throw BinaryFormatError("binary polynomial: truncated data");
+
+        exponents = data + sizeof(BinaryHeader);
+        coefficients = data + detail::align_up(sizeof(BinaryHeader) + header.length *
+            detail::exponent_width(encoding()), alignof(T));
+        validate_exponents();
+    }
+
+    // Size of the record in bytes, the next record of a sequence starts here
+    size_t size_bytes() const {
+        size_t offset = sizeof(BinaryHeader) + header.length * detail::exponent_width(encoding());
+        offset = detail::align_up(offset, alignof(T)) + header.length * sizeof(T);
+        return detail::align_up(offset, 8);
+    }
+
+    ExponentEncoding encoding() const {
+        return ExponentEncoding(header.exponent_encoding);
+    }
+
+    size_t length() const {
+        return header.length;
+    }
+
+    unsigned degree() const {
+        return header.degree;
+    }
+
+    const_iterator begin() const {
+        return const_iterator(exponents, coefficients, header.length, encoding());
+    }
+
+    const_iterator end() const {
+        return const_iterator(exponents + header.length * detail::exponent_width(encoding()),
+                              coefficients + header.length * sizeof(T), 0, encoding());
+    }
+
+    T coefficient(unsigned term) const {
+        if (encoding() == ExponentEncoding::Absolute32) {
+            // Binary search on the absolute exponents
+            size_t lo = 0, hi = header.length;
+            while (lo < hi) {
+                size_t mid = (lo + hi) / 2;
+                uint32_t exponent = detail::load<uint32_t>(exponents + 4 * mid);
+                if (exponent == term)
+                    return detail::load<T>(coefficients + mid * sizeof(T));
+                if (exponent < term)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return T();
+        }
+
+        for (auto term_pair : *this) {
+            if (term_pair.first == term)
+                return term_pair.second;
+            if (term_pair.first > term)
+                break;
+        }
+        return T();
+    }
+
+    Polynomial<T> to_polynomial() const {
+        Polynomial<T> result;
+        for (auto term : *this)
+            result.add_term(term.first, term.second);
+        return result;
+    }
+
+    Polynomial<T> differentiate() const {
+        Polynomial<T> result;
+        for (auto term : *this) {
+            if (term.first > 0) {
+                T coefficient = term.second;
+                coefficient *= term.first;
+                result.add_term(term.first - 1, coefficient);
+            }
+        }
+        return result;
+    }
+
+    bool operator== (const Polynomial<T> &other) const {
+        if (other.length() != length())
+            return false;
+        auto it = other.begin();
+        for (auto term : *this) {
+            if (term.first != it->first || term.second != it->second)
+                return false;
+            ++it;
+        }
+        return true;
+    }
+
+    bool operator!= (const Polynomial<T> &other) const {
+        return !(*this == other);
+    }
+
+    // evaluate the polynomial at a point, giving the same result as
+    // Polynomial<T>::operator()
+    template<typename U>
+    U operator() (U value) const {
+        return evaluate_terms(begin(), end(), value);
+    }
+
+    void print(std::ostream& os, const std::string &variable="x") const {
+        to_polynomial().print(os, variable);
+    }
+};
+
+template<typename T>
+std::ostream& operator<< (std::ostream& os, PolynomialView<T> const &p) {
+    p.print(os);
+    return os;
+}
+
+// Read a polynomial from the binary record at the start of a buffer
+template<typename T>
+Polynomial<T> read_binary(const void *buffer, size_t size) {
+    return PolynomialView<T>(buffer, size).to_polynomial();
+}
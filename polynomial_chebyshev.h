@@ -0,0 +1,439 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "polynomial.h"
+#include "polynomial_fft.h"
+
+// Polynomials in the Chebyshev basis, p(x) = sum c_k T_k(x), which is far
+// better conditioned on [-1, 1] than the monomial basis.
+//
+// Coefficients are stored densely. Evaluation uses Clenshaw's recurrence,
+// long products go through FFT convolutions using
+// T_i T_j = (T_{i+j} + T_{|i-j|}) / 2, and conversions to and from
+// Polynomial split the polynomial in halves around x^m or T_m for powers
+// of two m, so that they cost O(n log^2 n) instead of O(n^2).
+
+namespace detail {
+
+// Below this length products and conversions are done directly
+const size_t chebyshev_direct_length = 64;
+
+// Chebyshev coefficients of the product of two Chebyshev series
+template<typename R>
+std::vector<R> chebyshev_multiply(const std::vector<R> &a, const std::vector<R> &b) {
+    if (a.empty() || b.empty())
+        return {};
+
+    size_t length = a.size() + b.size() - 1;
+    std::vector<R> result(length, R(0));
+    if (std::min(a.size(), b.size()) <= chebyshev_direct_length) {
+        for (size_t i = 0; i < a.size(); ++i) {
+            for (size_t j = 0; j < b.size(); ++j) {
+                R product = a[i] * b[j] / 2;
+                result[i + j] += product;
+                result[i > j ? i - j : j - i] += product;
+            }
+        }
+        return result;
+    }
+
+    // The sums over i + j = k form a convolution, and those over
+    // |i - j| = k a convolution with b reversed, at offsets k and -k
+    // around the middle
+    std::vector<R> reversed(b.rbegin(), b.rend());
+    std::vector<R> sums = convolve(a, b), differences = convolve(a, reversed);
+    size_t middle = b.size() - 1;
+    result[0] = (sums[0] + differences[middle]) / 2;
+    for (size_t k = 1; k < length; ++k) {
+        R difference = 0;
+        if (k < a.size())
+            difference += differences[middle + k];
+        if (k < b.size())
+            difference += differences[middle - k];
+        result[k] = (sums[k] + difference) / 2;
+    }
+    return result;
+}
+
+// Largest power of two below n, for n >= 2
+inline size_t split_point(size_t n) {
+    size_t m = 1;
+    while (2 * m < n)
+        m <<= 1;
+    return m;
+}
+
+// Chebyshev coefficients of sum a_j x^j for j < n. powers[i] caches the
+// Chebyshev coefficients of x^(2^i).
+template<typename R>
+std::vector<R> monomial_to_chebyshev(const R *a, size_t n, std::vector<std::vector<R>> &powers) {
+    if (n <= chebyshev_direct_length) {
+        // Horner's rule with x T_0 = T_1 and x T_k = (T_{k+1} + T_{k-1}) / 2
+        std::vector<R> result(n, R(0)), shifted(n);
+        for (size_t j = n; j-- > 0; ) {
+            size_t degree = n - 1 - j;
+            std::fill(shifted.begin(), shifted.begin() + degree + 1, R(0));
+            if (degree > 0)
+                shifted[1] += result[0];
+            for (size_t k = 1; k < degree; ++k) {
+                shifted[k + 1] += result[k] / 2;
+                shifted[k - 1] += result[k] / 2;
+            }
+            shifted[0] += a[j];
+            std::swap(result, shifted);
+        }
+        return result;
+    }
+
+    // p = low + x^m high
+    size_t m = split_point(n), level = 0;
+    while ((size_t(1) << level) < m)
+        ++level;
+    if (powers.empty())
+        powers.push_back({R(0), R(1)});
+    while (powers.size() <= level)
+        powers.push_back(chebyshev_multiply(powers.back(), powers.back()));
+
+    std::vector<R> result = chebyshev_multiply(powers[level], monomial_to_chebyshev(a + m, n - m, powers));
+    std::vector<R> low = monomial_to_chebyshev(a, m, powers);
+    for (size_t k = 0; k < m; ++k)
+        result[k] += low[k];
+    return result;
+}
+
+// Monomial coefficients of sum c_k T_k for k < n. powers[i] caches the
+// monomial coefficients of T_(2^i).
+template<typename R>
+std::vector<R> chebyshev_to_monomial(const R *c, size_t n, std::vector<std::vector<R>> &powers) {
+    if (n <= chebyshev_direct_length) {
+        // Sum the terms with T_{k+1} = 2x T_k - T_{k-1}
+        std::vector<R> result(n, R(0)), previous(n, R(0)), current(n, R(0)), next(n);
+        if (n > 0) {
+            current[0] = 1;
+            result[0] = c[0];
+        }
+        for (size_t k = 1; k < n; ++k) {
+            next[0] = -previous[0];
+            for (size_t j = 1; j <= k; ++j)
+                next[j] = 2 * current[j - 1] - previous[j];
+            if (k == 1)
+                next[1] = 1;
+            for (size_t j = 0; j <= k; ++j)
+                result[j] += c[k] * next[j];
+            std::swap(previous, current);
+            std::swap(current, next);
+        }
+        return result;
+    }
+
+    // With T_{m+k} = 2 T_m T_k - T_{m-k}, p = low + T_m high where high
+    // has the coefficients c_m, 2 c_{m+1}, ... and low is c_0 ... c_{m-1}
+    // less c_{m+k} at m - k
+    size_t m = split_point(n), level = 0;
+    while ((size_t(1) << level) < m)
+        ++level;
+    if (powers.empty())
+        powers.push_back({R(0), R(1)});
+    while (powers.size() <= level) {
+        std::vector<R> square = convolve(powers.back(), powers.back());
+        for (auto &coefficient : square)
+            coefficient *= 2;
+        square[0] -= 1;
+        powers.push_back(std::move(square));
+    }
+
+    std::vector<R> low(c, c + m), high(n - m);
+    high[0] = c[m];
+    for (size_t k = 1; k < n - m; ++k) {
+        high[k] = 2 * c[m + k];
+        low[m - k] -= c[m + k];
+    }
+
+    std::vector<R> result = convolve(powers[level], chebyshev_to_monomial(high.data(), high.size(), powers));
+    std::vector<R> low_monomial = chebyshev_to_monomial(low.data(), m, powers);
+    for (size_t j = 0; j < m; ++j)
+        result[j] += low_monomial[j];
+    return result;
+}
+
+// y_k = sum_j v_j cos(pi k (2j + 1) / (2n)), the DCT-II, from a transform
+// of v extended symmetrically to length 2n
+template<typename R>
+std::vector<R> discrete_cosine_transform(const std::vector<R> &v) {
+    size_t n = v.size();
+    std::vector<std::complex<R>> extended(2 * n);
+    for (size_t j = 0; j < n; ++j)
+        extended[j] = extended[2 * n - 1 - j] = v[j];
+    dft(extended, false);
+
+    const R pi = std::acos(R(-1));
+    std::vector<R> result(n);
+    for (size_t k = 0; k < n; ++k)
+        result[k] = complex_multiply(extended[k], std::polar(R(1), -pi * R(k) / R(2 * n))).real() / 2;
+    return result;
+}
+
+} // namespace detail
+
+template<typename T>
+class ChebyshevPolynomial {
+    static_assert(std::is_floating_point<T>::value, "ChebyshevPolynomial needs floating point coefficients");
+
+ private:
+    // Coefficient of T_k at index k, without trailing zeros
+    std::vector<T> coefficients;
+
+    void trim() {
+        while (!coefficients.empty() && coefficients.back() == T())
+            coefficients.pop_back();
+    }
+
+ public:
+    ChebyshevPolynomial() = default;
+
+    // Coefficients in ascending order of degree
+    explicit ChebyshevPolynomial(std::vector<T> coefficients) : coefficients(std::move(coefficients)) {
+        trim();
+    }
+
+    ChebyshevPolynomial(T value) : coefficients{value} {
+        trim();
+    }
+
+    // Conversion from the monomial basis
+    explicit ChebyshevPolynomial(const Polynomial<T> &p) {
+        if (p.length() == 0)
+            return;
+        std::vector<T> monomial(size_t(p.degree()) + 1, T());
+        for (auto &term : p)
+            monomial[term.first] = term.second;
+        std::vector<std::vector<T>> powers;
+        coefficients = detail::monomial_to_chebyshev(monomial.data(), monomial.size(), powers);
+        trim();
+    }
+
+    // Interpolant of f at the degree + 1 Chebyshev points of the first
+    // kind, cos(pi (j + 1/2) / (degree + 1)), computed with a DCT
+    template<typename F>
+    static ChebyshevPolynomial interpolate(F f, unsigned degree) {
+        size_t n = size_t(degree) + 1;
+        const T pi = std::acos(T(-1));
+        std::vector<T> values(n);
+        for (size_t j = 0; j < n; ++j)
+            values[j] = T(f(std::cos(pi * (T(j) + T(0.5)) / T(n))));
+
+        std::vector<T> result = detail::discrete_cosine_transform(values);
+        for (auto &coefficient : result)
+            coefficient *= T(2) / T(n);
+        result[0] /= 2;
+        return ChebyshevPolynomial(std::move(result));
+    }
+
+    // Conversion to the monomial basis. The monomial coefficients of high
+    // degree Chebyshev polynomials grow like 2^n, so this loses accuracy
+    // for large degrees however it's computed.
+    Polynomial<T> to_polynomial() const {
+        std::vector<std::vector<T>> powers;
+        std::vector<T> monomial = detail::chebyshev_to_monomial(coefficients.data(), coefficients.size(), powers);
+        Polynomial<T> result;
+        for (size_t j = 0; j < monomial.size(); ++j)
+            result.add_term(unsigned(j), monomial[j]);
+        return result;
+    }
+
+    // Monomial form in x of the polynomial in t = (2x - lower - upper) / (upper - lower),
+    // the basis of an approximation on [lower, upper]
+    Polynomial<T> to_polynomial(T lower, T upper) const {
+        T half_width = (upper - lower) / 2, center = lower + half_width;
+        Polynomial<T> in_t = to_polynomial();
+        Polynomial<T> t(std::map<unsigned, T>({{0, -center / half_width}, {1, 1 / half_width}}));
+        Polynomial<T> result;
+        for (unsigned k = in_t.degree() + 1; k-- > 0; ) {
+            result *= t;
+            result.add_term(0, in_t.coefficient(k));
+        }
+        return result;
+    }
+
+    explicit operator Polynomial<T>() const {
+        return to_polynomial();
+    }
+
+    // Number of coefficients up to the last nonzero one
+    size_t length() const {
+        return coefficients.size();
+    }
+
+    // Highest k with a nonzero coefficient, 0 for the zero polynomial
+    unsigned degree() const {
+        return coefficients.empty() ? 0 : unsigned(coefficients.size() - 1);
+    }
+
+    T coefficient(unsigned k) const {
+        return k < coefficients.size() ? coefficients[k] : T();
+    }
+
+    ChebyshevPolynomial &operator+= (const ChebyshevPolynomial &rhs) {
+        if (coefficients.size() < rhs.coefficients.size())
+            coefficients.resize(rhs.coefficients.size(), T());
+        for (size_t k = 0; k < rhs.coefficients.size(); ++k)
+            coefficients[k] += rhs.coefficients[k];
+        trim();
+        return *this;
+    }
+
+    ChebyshevPolynomial &operator-= (const ChebyshevPolynomial &rhs) {
+        if (coefficients.size() < rhs.coefficients.size())
+            coefficients.resize(rhs.coefficients.size(), T());
+        for (size_t k = 0; k < rhs.coefficients.size(); ++k)
+            coefficients[k] -= rhs.coefficients[k];
+        trim();
+        return *this;
+    }
+
+    ChebyshevPolynomial &operator*= (const ChebyshevPolynomial &rhs) {
+        coefficients = detail::chebyshev_multiply(coefficients, rhs.coefficients);
+        trim();
+        return *this;
+    }
+
+    friend ChebyshevPolynomial operator+ (ChebyshevPolynomial lhs, const ChebyshevPolynomial &rhs) {
+        return lhs += rhs;
+    }
+
+    friend ChebyshevPolynomial operator- (ChebyshevPolynomial lhs, const ChebyshevPolynomial &rhs) {
+        return lhs -= rhs;
+    }
+
+    friend ChebyshevPolynomial operator* (const ChebyshevPolynomial &lhs, const ChebyshevPolynomial &rhs) {
+        return ChebyshevPolynomial(detail::chebyshev_multiply(lhs.coefficients, rhs.coefficients));
+    }
+
+    ChebyshevPolynomial operator- () const {
+        ChebyshevPolynomial result(*this);
+        for (auto &coefficient : result.coefficients)
+            coefficient = -coefficient;
+        return result;
+    }
+
+    // Derivative, from c'_{k-1} = c'_{k+1} + 2k c_k with c'_0 halved
+    ChebyshevPolynomial differentiate() const {
+        size_t n = coefficients.size();
+        if (n <= 1)
+            return ChebyshevPolynomial();
+
+        std::vector<T> result(n + 1, T());
+        for (size_t k = n - 1; k >= 1; --k)
+            result[k - 1] = result[k + 1] + T(2 * k) * coefficients[k];
+        result[0] /= 2;
+        result.resize(n - 1);
+        return ChebyshevPolynomial(std::move(result));
+    }
+
+    // Antiderivative vanishing at x = -1, from
+    // C_k = (c_{k-1} - c_{k+1}) / (2k) with c_0 doubled
+    ChebyshevPolynomial integrate() const {
+        size_t n = coefficients.size();
+        if (n == 0)
+            return ChebyshevPolynomial();
+
+        std::vector<T> result(n + 1, T());
+        for (size_t k = 1; k <= n; ++k) {
+            T previous = k == 1 ? 2 * coefficients[0] : coefficients[k - 1];
+            T next = k + 1 < n ? coefficients[k + 1] : T();
+            result[k] = (previous - next) / T(2 * k);
+        }
+        // T_k(-1) = (-1)^k
+        for (size_t k = 1; k <= n; ++k)
+            result[0] += k % 2 ? result[k] : -result[k];
+        return ChebyshevPolynomial(std::move(result));
+    }
+
+    bool operator== (ChebyshevPolynomial const &other) const {
+        return coefficients == other.coefficients;
+    }
+
+    bool operator!= (ChebyshevPolynomial const &other) const {
+        return !(*this == other);
+    }
+
+    // evaluate the polynomial at a point with Clenshaw's recurrence
+    // b_k = c_k + 2x b_{k+1} - b_{k+2}, p(x) = c_0 + x b_1 - b_2
+    template<typename U>
+    U operator() (U value) const {
+        if (coefficients.empty())
+            return U();
+        U b1 = U(), b2 = U(), twice = value + value;
+        for (size_t k = coefficients.size() - 1; k >= 1; --k) {
+            U b0 = U(coefficients[k]) + twice * b1 - b2;
+            b2 = b1;
+            b1 = b0;
+        }
+        return U(coefficients[0]) + value * b1 - b2;
+    }
+
+    // evaluate the polynomial at count points, running the recurrence over
+    // blocks of points so that the inner loops vectorize
+    template<typename U>
+    void evaluate(const U *points, size_t count, U *values) const {
+        if (coefficients.empty()) {
+            std::fill(values, values + count, U());
+            return;
+        }
+
+        const size_t block = 64;
+        U b1[block], b2[block];
+        for (size_t offset = 0; offset < count; offset += block) {
+            size_t n = std::min(block, count - offset);
+            const U *x = points + offset;
+            std::fill(b1, b1 + n, U());
+            std::fill(b2, b2 + n, U());
+            for (size_t k = coefficients.size() - 1; k >= 1; --k) {
+                U c = U(coefficients[k]);
+                for (size_t i = 0; i < n; ++i) {
+                    U b0 = c + (x[i] + x[i]) * b1[i] - b2[i];
+                    b2[i] = b1[i];
+                    b1[i] = b0;
+                }
+            }
+            U c = U(coefficients[0]);
+            for (size_t i = 0; i < n; ++i)
+                values[offset + i] = c + x[i] * b1[i] - b2[i];
+        }
+    }
+
+    void print(std::ostream& os, const std::string &variable="x") const {
+        if (coefficients.empty()) {
+            os << T();
+            return;
+        }
+
+        bool first = true;
+        for (size_t k = coefficients.size(); k-- > 0; ) {
+            T c = coefficients[k];
+            if (c == T())
+                continue;
+            if (first)
+                os << c;
+            else
+                os << (tSign(c) ? " - " : " + ") << tAbs(c);
+            if (k > 0)
+                os << "T_" << k << "(" << variable << ")";
+            first = false;
+        }
+    }
+};
+
+template<typename T>
+std::ostream& operator<< (std::ostream& os, ChebyshevPolynomial<T> const &p) {
+    p.print(os);
+    return os;
+}
@@ -0,0 +1,207 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include "polynomial.h"
+
+// Compensated Horner evaluation (Graillat, Langlois and Louvet).
+//
+// The rounding errors of every product and sum of Horner's rule are
+// computed exactly with the error-free transformations TwoProduct and
+// TwoSum, and evaluated as a second polynomial that corrects the result.
+// The result is as accurate as Horner's rule in twice the working
+// precision, |result - p(x)| <= u |p(x)| + O(u^2) cond(p, x), at a few
+// times the cost of the plain evaluation.
+//
+// TwoProduct uses a fused multiply-add when the target has a fast one
+// (FP_FAST_FMA, e.g. with -mfma or -march=native), and Dekker's splitting
+// otherwise, which avoids a slow software fma.
+
+template<typename R>
+struct CompensatedValue {
+    R value;
+    // Bound of |value - p(x)| for the coefficients converted to R
+    R error_bound;
+};
+
+namespace detail {
+
+template<typename R>
+struct HasFastFma : std::false_type {};
+
+#ifdef FP_FAST_FMAF
+template<>
+struct HasFastFma<float> : std::true_type {};
+#endif
+#ifdef FP_FAST_FMA
+template<>
+struct HasFastFma<double> : std::true_type {};
+#endif
+#ifdef FP_FAST_FMAL
+template<>
+struct HasFastFma<long double> : std::true_type {};
+#endif
+
+// a + b = sum + error exactly
+template<typename R>
+void two_sum(R a, R b, R &sum, R &error) {
+    sum = a + b;
+    R z = sum - a;
+    error = (a - (sum - z)) + (b - z);
+}
+
+// a * b = product + error exactly
+template<typename R>
+void two_product(R a, R b, R &product, R &error) {
+    product = a * b;
+    if constexpr (HasFastFma<R>::value) {
+        error = std::fma(a, b, -product);
+    } else {
+        // Split into halves that multiply without rounding
+        const R splitter = R((1ull << ((std::numeric_limits<R>::digits + 1) / 2)) + 1);
+        R ta = splitter * a, a_high = ta - (ta - a), a_low = a - a_high;
+        R tb = splitter * b, b_high = tb - (tb - b), b_low = b - b_high;
+        error = a_low * b_low - (((product - a_high * b_high) - a_low * b_high) - a_high * b_low);
+    }
+}
+
+// Running error bound of Langlois and Louvet: with the Horner sum e of
+// the magnitudes of the error terms,
+// |result - p(x)| <= (u |result| + (gamma(4n + 2) e + 2 u^2 |result|)) / (1 - 2 (n + 1) u)
+template<typename R>
+R compensated_error_bound(R result, R error_sum, unsigned degree) {
+    const R u = std::numeric_limits<R>::epsilon() / 2;
+    R n = R(degree);
+    R gamma = (4 * n + 2) * u / (1 - (4 * n + 2) * u);
+    return (u * std::fabs(result) + (gamma * error_sum + 2 * u * u * std::fabs(result))) / (1 - 2 * (n + 1) * u);
+}
+
+// Compensated Horner over terms in descending order of exponent, stepping
+// through the gaps between exponents
+template<typename Iterator, typename R>
+CompensatedValue<R> evaluate_terms_compensated(Iterator first, Iterator last, R x) {
+    if (first == last)
+        return {R(0), R(0)};
+
+    unsigned degree = first->first, exponent = degree;
+    R s = R(first->second), correction = 0, error_sum = 0, abs_x = std::fabs(x);
+
+    auto step = [&](R coefficient) {
+        R product, product_error, sum_error;
+        two_product(s, x, product, product_error);
+        two_sum(product, coefficient, s, sum_error);
+        correction = correction * x + (product_error + sum_error);
+        error_sum = error_sum * abs_x + (std::fabs(product_error) + std::fabs(sum_error));
+        exponent -= 1;
+    };
+
+    // Step over a missing term, where the sum is exact
+    auto shift = [&]() {
+        R product_error;
+        two_product(s, x, s, product_error);
+        correction = correction * x + product_error;
+        error_sum = error_sum * abs_x + std::fabs(product_error);
+        exponent -= 1;
+    };
+
+    for (++first; first != last; ++first) {
+        while (exponent > first->first + 1)
+            shift();
+        step(R(first->second));
+    }
+    while (exponent > 0)
+        shift();
+
+    R result = s + correction;
+    return {result, compensated_error_bound(result, error_sum, degree)};
+}
+
+// The same for count points at once, with the inner loops running over
+// contiguous points so that they vectorize. error_bounds may be null.
+template<typename Iterator, typename R>
+void evaluate_terms_compensated(Iterator first, Iterator last, const R *x, size_t count,
+                                R *values, R *error_bounds) {
+    if (first == last) {
+        std::fill(values, values + count, R(0));
+        if (error_bounds)
+            std::fill(error_bounds, error_bounds + count, R(0));
+        return;
+    }
+
+    const size_t block = 64;
+    R s[block], correction[block], error_sum[block];
+    unsigned degree = first->first;
+
+    for (size_t offset = 0; offset < count; offset += block) {
+        size_t n = std::min(block, count - offset);
+        const R *points = x + offset;
+        unsigned exponent = degree;
+
+        auto step = [&](R coefficient) {
+            for (size_t i = 0; i < n; ++i) {
+                R product, product_error, sum_error;
+                two_product(s[i], points[i], product, product_error);
+                two_sum(product, coefficient, s[i], sum_error);
+                correction[i] = correction[i] * points[i] + (product_error + sum_error);
+                error_sum[i] = error_sum[i] * std::fabs(points[i]) + (std::fabs(product_error) + std::fabs(sum_error));
+            }
+            exponent -= 1;
+        };
+        auto shift = [&]() {
+            for (size_t i = 0; i < n; ++i) {
+                R product_error;
+                two_product(s[i], points[i], s[i], product_error);
+                correction[i] = correction[i] * points[i] + product_error;
+                error_sum[i] = error_sum[i] * std::fabs(points[i]) + std::fabs(product_error);
+            }
+            exponent -= 1;
+        };
+
+        Iterator term = first;
+        std::fill(s, s + n, R(term->second));
+        std::fill(correction, correction + n, R(0));
+        std::fill(error_sum, error_sum + n, R(0));
+        for (++term; term != last; ++term) {
+            while (exponent > term->first + 1)
+                shift();
+            step(R(term->second));
+        }
+        while (exponent > 0)
+            shift();
+
+        for (size_t i = 0; i < n; ++i) {
+            values[offset + i] = s[i] + correction[i];
+            if (error_bounds)
+                error_bounds[offset + i] = compensated_error_bound(values[offset + i], error_sum[i], degree);
+        }
+    }
+}
+
+} // namespace detail
+
+// p(x) with compensated Horner evaluation
+template<typename T, typename R>
+R evaluate_compensated(const Polynomial<T> &p, R x) {
+    static_assert(std::is_floating_point<R>::value, "compensated evaluation needs a floating point argument");
+    return detail::evaluate_terms_compensated(std::make_reverse_iterator(p.end()),
+                                              std::make_reverse_iterator(p.begin()), x).value;
+}
+
+// p(x) with a bound of its rounding error
+template<typename T, typename R>
+CompensatedValue<R> evaluate_compensated_with_bound(const Polynomial<T> &p, R x) {
+    static_assert(std::is_floating_point<R>::value, "compensated evaluation needs a floating point argument");
+    return detail::evaluate_terms_compensated(std::make_reverse_iterator(p.end()),
+                                              std::make_reverse_iterator(p.begin()), x);
+}
+
+// p(x[i]) for count points, and their error bounds if error_bounds isn't null
+template<typename T, typename R>
+void evaluate_compensated(const Polynomial<T> &p, const R *x, size_t count, R *values,
+                          R *error_bounds = nullptr) {
+    static_assert(std::is_floating_point<R>::value, "compensated evaluation needs a floating point argument");
+    detail::evaluate_terms_compensated(std::make_reverse_iterator(p.end()),
+                                       std::make_reverse_iterator(p.begin()), x, count, values, error_bounds);
+}
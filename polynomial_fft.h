@@ -0,0 +1,220 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// Fast Fourier transforms over floating point coefficient arrays, and
+// number theoretic transforms over integer residues, used to multiply and
+// convert dense polynomials in O(n log n).
+
+namespace detail {
+
+// Plain complex product, avoiding the NaN and infinity recovery of
+// std::complex's operator*
+template<typename R>
+std::complex<R> complex_multiply(std::complex<R> a, std::complex<R> b) {
+    return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+}
+
+// Smallest power of two >= n
+inline size_t fft_size(size_t n) {
+    size_t size = 1;
+    while (size < n)
+        size <<= 1;
+    return size;
+}
+
+// Reorder a sequence whose length is a power of two by bit-reversed index
+template<typename V>
+void bit_reverse_permute(std::vector<V> &a) {
+    size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(a[i], a[j]);
+    }
+}
+
+// Twiddle factors exp(-+2 pi i k / n) for k < n / 2, for transforms of
+// length n. Each is computed directly rather than by repeated
+// multiplication, which would accumulate rounding errors.
+template<typename R>
+std::vector<std::complex<R>> fft_roots(size_t n, bool inverse) {
+    const R pi = std::acos(R(-1));
+    std::vector<std::complex<R>> roots(n / 2);
+    for (size_t k = 0; k < n / 2; ++k)
+        roots[k] = std::polar(R(1), (inverse ? 2 : -2) * pi * R(k) / R(n));
+    return roots;
+}
+
+// In-place radix-2 transform of a sequence whose length is a power of two,
+// X_k = sum_j x_j exp(-+2 pi i jk / n), with the roots of fft_roots(). The
+// inverse isn't scaled by 1/n.
+template<typename R>
+void fft(std::vector<std::complex<R>> &a, const std::vector<std::complex<R>> &roots) {
+    size_t n = a.size();
+    bit_reverse_permute(a);
+    for (size_t length = 2; length <= n; length <<= 1) {
+        size_t half = length / 2, stride = n / length;
+        for (size_t i = 0; i < n; i += length) {
+            for (size_t j = 0; j < half; ++j) {
+                std::complex<R> u = a[i + j], v = complex_multiply(a[i + j + half], roots[j * stride]);
+                a[i + j] = u + v;
+                a[i + j + half] = u - v;
+            }
+        }
+    }
+}
+
+template<typename R>
+void fft(std::vector<std::complex<R>> &a, bool inverse) {
+    fft(a, fft_roots<R>(a.size(), inverse));
+}
+
+// Transform of a sequence of any length. Lengths other than powers of two
+// go through Bluestein's algorithm, as a convolution with a chirp.
+template<typename R>
+void dft(std::vector<std::complex<R>> &a, bool inverse) {
+    size_t n = a.size();
+    if (n <= 1)
+        return;
+    if ((n & (n - 1)) == 0) {
+        fft(a, inverse);
+        return;
+    }
+
+    // jk = (j^2 + k^2 - (k - j)^2) / 2, with j^2 reduced modulo 2n to keep
+    // the angles small
+    const R pi = std::acos(R(-1));
+    std::vector<std::complex<R>> chirp(n);
+    for (size_t j = 0; j < n; ++j) {
+        unsigned long long square = (unsigned long long)j * j % (2 * n);
+        chirp[j] = std::polar(R(1), (inverse ? 1 : -1) * pi * R(square) / R(n));
+    }
+
+    size_t m = fft_size(2 * n - 1);
+    std::vector<std::complex<R>> x(m), kernel(m);
+    for (size_t j = 0; j < n; ++j)
+        x[j] = complex_multiply(a[j], chirp[j]);
+    kernel[0] = std::conj(chirp[0]);
+    for (size_t j = 1; j < n; ++j)
+        kernel[j] = kernel[m - j] = std::conj(chirp[j]);
+
+    fft(x, false);
+    fft(kernel, false);
+    for (size_t i = 0; i < m; ++i)
+        x[i] = complex_multiply(x[i], kernel[i]);
+    fft(x, true);
+    for (size_t k = 0; k < n; ++k)
+        a[k] = complex_multiply(chirp[k], x[k]) / R(m);
+}
+
+// Coefficients of the product of two dense polynomials. Short operands are
+// multiplied directly. Otherwise both go into one complex transform as
+// a + i s b, whose square has 2 s (a * b) as its imaginary part; s
+// balances the magnitudes of the two operands.
+template<typename R>
+std::vector<R> convolve(const std::vector<R> &a, const std::vector<R> &b) {
+    static_assert(std::is_floating_point<R>::value, "convolve needs floating point coefficients");
+    if (a.empty() || b.empty())
+        return {};
+
+    size_t length = a.size() + b.size() - 1;
+    if (std::min(a.size(), b.size()) <= 32) {
+        std::vector<R> result(length, R(0));
+        for (size_t i = 0; i < a.size(); ++i)
+            for (size_t j = 0; j < b.size(); ++j)
+                result[i + j] += a[i] * b[j];
+        return result;
+    }
+
+    R max_a = 0, max_b = 0;
+    for (R c : a)
+        max_a = std::max(max_a, std::fabs(c));
+    for (R c : b)
+        max_b = std::max(max_b, std::fabs(c));
+    if (max_a == 0 || max_b == 0)
+        return std::vector<R>(length, R(0));
+    R s = max_a / max_b;
+
+    size_t n = fft_size(length);
+    std::vector<std::complex<R>> z(n);
+    for (size_t i = 0; i < a.size(); ++i)
+        z[i].real(a[i]);
+    for (size_t i = 0; i < b.size(); ++i)
+        z[i].imag(s * b[i]);
+
+    fft(z, false);
+    for (auto &c : z)
+        c = complex_multiply(c, c);
+    fft(z, true);
+
+    std::vector<R> result(length);
+    R scale = 1 / (2 * s * R(n));
+    for (size_t i = 0; i < length; ++i)
+        result[i] = z[i].imag() * scale;
+    return result;
+}
+
+// Number theoretic transforms modulo primes p = c 2^k + 1, for exact
+// products of integer coefficients. Residues are below 2^30, so products
+// fit in 64 bits.
+struct NttPrime {
+    uint64_t modulus;
+    uint64_t generator;
+    // Largest power of two dividing modulus - 1
+    unsigned max_log_size;
+};
+
+const NttPrime ntt_primes[2] = {{998244353, 3, 23}, {469762049, 3, 26}};
+
+inline uint64_t power_mod(uint64_t base, uint64_t exponent, uint64_t modulus) {
+    uint64_t result = 1;
+    for (base %= modulus; exponent; exponent >>= 1) {
+        if (exponent & 1)
+            result = result * base % modulus;
+        base = base * base % modulus;
+    }
+    return result;
+}
+
+// Powers w^k for k < n / 2 of a primitive n-th root of unity w, or of
+// its inverse
+inline std::vector<uint64_t> ntt_roots(size_t n, const NttPrime &prime, bool inverse) {
+    uint64_t p = prime.modulus;
+    uint64_t w = power_mod(prime.generator, (p - 1) / n, p);
+    if (inverse)
+        w = power_mod(w, p - 2, p);
+    std::vector<uint64_t> roots(n / 2);
+    uint64_t r = 1;
+    for (auto &root : roots) {
+        root = r;
+        r = r * w % p;
+    }
+    return roots;
+}
+
+// In-place transform of residues of a power of two length, unscaled like fft()
+inline void ntt(std::vector<uint64_t> &a, const std::vector<uint64_t> &roots, uint64_t p) {
+    size_t n = a.size();
+    bit_reverse_permute(a);
+    for (size_t length = 2; length <= n; length <<= 1) {
+        size_t half = length / 2, stride = n / length;
+        for (size_t i = 0; i < n; i += length) {
+            for (size_t j = 0; j < half; ++j) {
+                uint64_t u = a[i + j], v = a[i + j + half] * roots[j * stride] % p;
+                a[i + j] = u + v < p ? u + v : u + v - p;
+                a[i + j + half] = u >= v ? u - v : u + p - v;
+            }
+        }
+    }
+}
+
+} // namespace detail
@@ -0,0 +1,235 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "polynomial.h"
+#include "polynomial_chebyshev.h"
+#include "polynomial_parallel.h"
+#include "thread_pool.h"
+
+// Weighted least-squares polynomial fitting over large numbers of samples.
+//
+// The fit minimizes sum w_i (y_i - p(x_i))^2 in the Chebyshev basis of the
+// sample interval mapped to [-1, 1], whose design matrix is well
+// conditioned. Instead of forming the normal equations, which would square
+// the condition number, samples are rotated one at a time into the
+// triangular factor R of a QR decomposition with Givens rotations, keeping
+// only R, Q^T y and the residual: O(degree^2) memory however many samples
+// there are. Factors of separate chunks of samples are merged by rotating
+// the rows of one into the other, which lets chunks be fitted on separate
+// threads.
+
+template<typename T>
+struct LeastSquaresFit {
+    // Fitted polynomial in the Chebyshev basis of t = (2x - lower - upper) / (upper - lower)
+    ChebyshevPolynomial<T> chebyshev;
+    T lower;
+    T upper;
+    // Weighted sum of squared residuals
+    T residual;
+    size_t samples;
+
+    // Monomial form in x, which loses accuracy for high degrees on
+    // intervals far from [-1, 1]
+    Polynomial<T> polynomial() const {
+        return chebyshev.to_polynomial(lower, upper);
+    }
+
+    // evaluate the fit at a point through the Chebyshev form
+    template<typename U>
+    U operator() (U x) const {
+        return chebyshev((U(2) * x - U(lower) - U(upper)) / (U(upper) - U(lower)));
+    }
+};
+
+// Accumulates the QR factorization of a fit of the given degree on
+// [lower, upper] over samples added in any number of chunks, in a single
+// pass and bounded memory. Samples outside the interval are allowed but
+// make the basis less well conditioned.
+template<typename T>
+class PolynomialFitter {
+    static_assert(std::is_floating_point<T>::value, "PolynomialFitter needs floating point samples");
+
+ private:
+    unsigned n;
+    T lower, upper;
+    // n x n upper triangular factor, row-major
+    std::vector<T> r;
+    std::vector<T> qty;
+    std::vector<T> row;
+    T residual = 0;
+    size_t samples = 0;
+
+    // Rotate the row a with right-hand side b into R, zeroing it from the
+    // left; what is left of b is outside the span of the basis
+    void rotate_in(T *a, T b) {
+        for (unsigned k = 0; k < n; ++k) {
+            if (a[k] == T())
+                continue;
+            T *rk = &r[size_t(k) * n];
+            T h = std::sqrt(rk[k] * rk[k] + a[k] * a[k]);
+            T c = rk[k] / h, s = a[k] / h;
+            for (unsigned j = k; j < n; ++j) {
+                T u = rk[j], v = a[j];
+                rk[j] = c * u + s * v;
+                a[j] = c * v - s * u;
+            }
+            T u = qty[k];
+            qty[k] = c * u + s * b;
+            b = c * b - s * u;
+        }
+        residual += b * b;
+    }
+
+ public:
+    PolynomialFitter(unsigned degree, T lower, T upper)
+        : n(degree + 1), lower(lower), upper(upper), r(size_t(n) * n, T()), qty(n, T()), row(n) {
+        if (!(lower < upper))
+            throw std::invalid_argument("PolynomialFitter: interval is empty");
+    }
+
+    size_t size() const {
+        return samples;
+    }
+
+    // Add a sample with a nonnegative weight
+    void add(T x, T y, T weight = T(1)) {
+        if (!(weight >= 0))
+            throw std::invalid_argument("PolynomialFitter: weights must be nonnegative");
+        samples += 1;
+        if (weight == 0)
+            return;
+
+        // sqrt(w) T_k(t)
+        T scale = std::sqrt(weight), t = (2 * x - lower - upper) / (upper - lower);
+        row[0] = scale;
+        if (n > 1)
+            row[1] = scale * t;
+        for (unsigned k = 2; k < n; ++k)
+            row[k] = 2 * t * row[k - 1] - row[k - 2];
+        rotate_in(row.data(), scale * y);
+    }
+
+    // Add count samples, weighted by weights[i] unless weights is null
+    void add(const T *xs, const T *ys, size_t count, const T *weights = nullptr) {
+        for (size_t i = 0; i < count; ++i)
+            add(xs[i], ys[i], weights ? weights[i] : T(1));
+    }
+
+    // Add the samples of a fitter with the same degree and interval
+    void merge(const PolynomialFitter &other) {
+        if (other.n != n || other.lower != lower || other.upper != upper)
+            throw std::invalid_argument("PolynomialFitter: merged fitters differ in degree or interval");
+        for (unsigned k = 0; k < n; ++k) {
+            std::copy(other.r.begin() + size_t(k) * n, other.r.begin() + size_t(k + 1) * n, row.begin());
+            rotate_in(row.data(), other.qty[k]);
+        }
+        // The rows of other's R carry none of its residual
+        residual += other.residual;
+        samples += other.samples;
+    }
+
+    // Solve R c = Q^T y. Throws std::runtime_error if the samples don't
+    // determine a polynomial of the degree, e.g. with fewer distinct
+    // points than degree + 1.
+    LeastSquaresFit<T> result() const {
+        T largest = 0;
+        for (unsigned k = 0; k < n; ++k)
+            largest = std::max(largest, std::fabs(r[size_t(k) * n + k]));
+        std::vector<T> c(qty);
+        for (unsigned k = n; k-- > 0; ) {
+            const T *rk = &r[size_t(k) * n];
+            if (!(std::fabs(rk[k]) > n * std::numeric_limits<T>::epsilon() * largest))
+                throw std::runtime_error("fit: samples don't determine a polynomial of this degree");
+            for (unsigned j = k + 1; j < n; ++j)
+                c[k] -= rk[j] * c[j];
+            c[k] /= rk[k];
+        }
+        return {ChebyshevPolynomial<T>(std::move(c)), lower, upper, residual, samples};
+    }
+};
+
+namespace detail {
+
+// Fit in chunks handed to run(count, task). The number and bounds of the
+// chunks depend only on the number of samples and the factors are merged
+// in order, so the result doesn't depend on the number of threads.
+template<typename T, typename Run>
+LeastSquaresFit<T> fit_chunks(const T *xs, const T *ys, size_t count, unsigned degree,
+                              const T *weights, Run run) {
+    const size_t min_chunk = 1 << 16, max_chunks = 256;
+    size_t chunks = std::max<size_t>(1, std::min(max_chunks, (count + min_chunk - 1) / min_chunk));
+    size_t width = (count + chunks - 1) / chunks;
+    auto first = [&](size_t chunk) {
+        return std::min(count, chunk * width);
+    };
+
+    // Sample interval, and weights checked here since tasks must not throw
+    std::vector<T> lows(chunks, std::numeric_limits<T>::infinity());
+    std::vector<T> highs(chunks, -std::numeric_limits<T>::infinity());
+    std::vector<char> valid(chunks, 1);
+    run(chunks, [&](size_t chunk) {
+        for (size_t i = first(chunk); i < first(chunk + 1); ++i) {
+            lows[chunk] = std::min(lows[chunk], xs[i]);
+            highs[chunk] = std::max(highs[chunk], xs[i]);
+            if (weights && !(weights[i] >= 0))
+                valid[chunk] = 0;
+        }
+    });
+    if (std::find(valid.begin(), valid.end(), 0) != valid.end())
+        throw std::invalid_argument("fit: weights must be nonnegative");
+    T lower = *std::min_element(lows.begin(), lows.end());
+    T upper = *std::max_element(highs.begin(), highs.end());
+    if (count == 0) {
+        lower = -1;
+        upper = 1;
+    } else if (!(lower < upper)) {
+        // All samples at one point: only a constant is determined
+        lower -= 1;
+        upper += 1;
+    }
+
+    std::vector<PolynomialFitter<T>> fitters(chunks, PolynomialFitter<T>(degree, lower, upper));
+    run(chunks, [&](size_t chunk) {
+        size_t begin = first(chunk);
+        fitters[chunk].add(xs + begin, ys + begin, first(chunk + 1) - begin, weights ? weights + begin : nullptr);
+    });
+    for (size_t chunk = 1; chunk < chunks; ++chunk)
+        fitters[0].merge(fitters[chunk]);
+    return fitters[0].result();
+}
+
+} // namespace detail
+
+// Least-squares fit of a polynomial of the given degree to the samples
+// (xs[i], ys[i]) on their interval, weighted by weights[i] if weights
+// isn't empty, using up to `threads` threads
+template<typename T>
+LeastSquaresFit<T> fit(const std::vector<T> &xs, const std::vector<T> &ys, unsigned degree,
+                       const std::vector<T> &weights = {},
+                       unsigned threads = detail::default_thread_count()) {
+    static_assert(std::is_floating_point<T>::value, "fit needs floating point samples");
+    if (xs.size() != ys.size() || (!weights.empty() && weights.size() != xs.size()))
+        throw std::invalid_argument("fit: sample arrays differ in length");
+    return detail::fit_chunks(xs.data(), ys.data(), xs.size(), degree,
+                              weights.empty() ? nullptr : weights.data(), [threads](size_t n, auto task) {
+        detail::parallel_for(n, threads, task);
+    });
+}
+
+// Least-squares fit on the workers of a thread pool
+template<typename T>
+LeastSquaresFit<T> fit(const std::vector<T> &xs, const std::vector<T> &ys, unsigned degree,
+                       const std::vector<T> &weights, ThreadPool &pool) {
+    static_assert(std::is_floating_point<T>::value, "fit needs floating point samples");
+    if (xs.size() != ys.size() || (!weights.empty() && weights.size() != xs.size()))
+        throw std::invalid_argument("fit: sample arrays differ in length");
+    return detail::fit_chunks(xs.data(), ys.data(), xs.size(), degree,
+                              weights.empty() ? nullptr : weights.data(), [&pool](size_t n, auto task) {
+        pool.parallel_for(n, task, 1);
+    });
+}
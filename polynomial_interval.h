@@ -0,0 +1,239 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include "polynomial.h"
+
+// Guaranteed enclosures of the range of a polynomial over an interval.
+//
+// The enclosure is the intersection of the natural interval extension of
+// Horner's rule and the mean value form p(c) + p'(X) (X - c) around the
+// midpoint c, which is much tighter on narrow intervals. When p'(X)
+// excludes zero p is monotone on X and the enclosure is narrowed to the
+// values at the end points.
+//
+// Instead of switching the rounding mode, every bound is computed with
+// round to nearest and then moved outward by two units in the last place.
+// This keeps the arithmetic branch-free, so the batch evaluation over
+// blocks of intervals vectorizes, and doesn't depend on the compiler
+// honoring rounding mode changes.
+
+template<typename R>
+struct Interval {
+    static_assert(std::is_floating_point<R>::value, "Interval bounds must be floating point");
+
+    R lower;
+    R upper;
+
+    R width() const {
+        return upper - lower;
+    }
+
+    bool contains(R value) const {
+        return lower <= value && value <= upper;
+    }
+};
+
+namespace detail {
+
+// Bounds below and above the exact result of a rounded operation
+template<typename R>
+R round_down(R x) {
+    return x - (std::fabs(x) * (2 * std::numeric_limits<R>::epsilon()) + std::numeric_limits<R>::denorm_min());
+}
+
+template<typename R>
+R round_up(R x) {
+    return x + (std::fabs(x) * (2 * std::numeric_limits<R>::epsilon()) + std::numeric_limits<R>::denorm_min());
+}
+
+template<typename R>
+void interval_multiply(R al, R au, R bl, R bu, R &lower, R &upper) {
+    R p1 = al * bl, p2 = al * bu, p3 = au * bl, p4 = au * bu;
+    lower = round_down(std::min(std::min(p1, p2), std::min(p3, p4)));
+    upper = round_up(std::max(std::max(p1, p2), std::max(p3, p4)));
+}
+
+// x^n for x >= 0, rounded down or up
+template<typename R>
+R power_down(R x, unsigned n) {
+    R result = 1;
+    for (; n; n >>= 1) {
+        if (n & 1)
+            result = std::max(R(0), round_down(result * x));
+        if (n > 1)
+            x = std::max(R(0), round_down(x * x));
+    }
+    return result;
+}
+
+template<typename R>
+R power_up(R x, unsigned n) {
+    R result = 1;
+    for (; n; n >>= 1) {
+        if (n & 1)
+            result = round_up(result * x);
+        if (n > 1)
+            x = round_up(x * x);
+    }
+    return result;
+}
+
+// Enclosure of {x^n : x in [xl, xu]} for each interval
+template<typename R>
+void interval_power(const R *xl, const R *xu, size_t count, unsigned n, R *pl, R *pu) {
+    if (n == 1) {
+        std::copy(xl, xl + count, pl);
+        std::copy(xu, xu + count, pu);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        R a = std::fabs(xl[i]), b = std::fabs(xu[i]);
+        if (n % 2) {
+            // Odd powers are increasing
+            pl[i] = xl[i] >= 0 ? power_down(a, n) : -power_up(a, n);
+            pu[i] = xu[i] >= 0 ? power_up(b, n) : -power_down(b, n);
+        } else {
+            R smallest = xl[i] <= 0 && xu[i] >= 0 ? R(0) : std::min(a, b);
+            pl[i] = power_down(smallest, n);
+            pu[i] = power_up(std::max(a, b), n);
+        }
+    }
+}
+
+// Bounds of a coefficient converted to R
+template<typename R, typename T>
+void coefficient_bounds(T c, R &lower, R &upper) {
+    lower = upper = R(c);
+    if (std::is_integral<T>::value && std::numeric_limits<T>::digits > std::numeric_limits<R>::digits) {
+        lower = round_down(lower);
+        upper = round_up(upper);
+    } else if (std::is_floating_point<T>::value && std::numeric_limits<T>::digits > std::numeric_limits<R>::digits) {
+        // Wider floating point: the conversion rounded to nearest, so move
+        // the bound on the wrong side of c by one ulp
+        if (T(lower) > c)
+            lower = std::nextafter(lower, -std::numeric_limits<R>::infinity());
+        else if (T(upper) < c)
+            upper = std::nextafter(upper, std::numeric_limits<R>::infinity());
+    }
+}
+
+// Enclose sum c_e x^e over count intervals with Horner's rule, where
+// for_each_term(f) calls f(e, lower, upper) for the terms in descending
+// order of exponent
+template<typename R, typename Terms>
+void horner_enclosure(const R *xl, const R *xu, size_t count, Terms for_each_term, R *rl, R *ru) {
+    const size_t max_block = 64;
+    R pl[max_block], pu[max_block];
+
+    bool first = true;
+    unsigned exponent = 0;
+    auto multiply_power = [&](unsigned n) {
+        interval_power(xl, xu, count, n, pl, pu);
+        for (size_t i = 0; i < count; ++i)
+            interval_multiply(rl[i], ru[i], pl[i], pu[i], rl[i], ru[i]);
+    };
+
+    for_each_term([&](unsigned e, R cl, R cu) {
+        if (first) {
+            std::fill(rl, rl + count, cl);
+            std::fill(ru, ru + count, cu);
+            first = false;
+        } else {
+            multiply_power(exponent - e);
+            for (size_t i = 0; i < count; ++i) {
+                rl[i] = round_down(rl[i] + cl);
+                ru[i] = round_up(ru[i] + cu);
+            }
+        }
+        exponent = e;
+    });
+
+    if (first) {
+        std::fill(rl, rl + count, R(0));
+        std::fill(ru, ru + count, R(0));
+    } else if (exponent > 0) {
+        multiply_power(exponent);
+    }
+}
+
+// Enclose p over at most 64 intervals
+template<typename T, typename R>
+void enclose_block(const Polynomial<T> &p, const Interval<R> *x, size_t count, Interval<R> *out) {
+    static_assert(std::is_integral<T>::value || std::is_floating_point<T>::value,
+                  "interval evaluation needs real coefficients");
+    const size_t max_block = 64;
+    R xl[max_block] = {}, xu[max_block] = {}, center[max_block] = {};
+    R nl[max_block], nu[max_block], dl[max_block], du[max_block];
+    R cl[max_block], cu[max_block], el[max_block], eu[max_block];
+
+    auto terms = [&p](auto f) {
+        for (auto it = p.end(); it != p.begin();) {
+            --it;
+            R lower, upper;
+            coefficient_bounds(it->second, lower, upper);
+            f(it->first, lower, upper);
+        }
+    };
+    auto derivative_terms = [&p](auto f) {
+        for (auto it = p.end(); it != p.begin();) {
+            --it;
+            if (it->first == 0)
+                break;
+            R lower, upper;
+            coefficient_bounds(it->second, lower, upper);
+            R e = R(it->first);
+            f(it->first - 1, round_down(std::min(e * lower, e * upper)), round_up(std::max(e * lower, e * upper)));
+        }
+    };
+
+    for (size_t i = 0; i < count; ++i) {
+        xl[i] = x[i].lower;
+        xu[i] = x[i].upper;
+        center[i] = xl[i] + (xu[i] - xl[i]) / 2;
+    }
+
+    // Natural extension and derivative over X
+    horner_enclosure(xl, xu, count, terms, nl, nu);
+    horner_enclosure(xl, xu, count, derivative_terms, dl, du);
+
+    // Mean value form p(c) + p'(X) (X - c)
+    horner_enclosure(center, center, count, terms, cl, cu);
+    for (size_t i = 0; i < count; ++i) {
+        R ml, mu;
+        interval_multiply(dl[i], du[i], round_down(xl[i] - center[i]), round_up(xu[i] - center[i]), ml, mu);
+        out[i].lower = std::max(nl[i], round_down(cl[i] + ml));
+        out[i].upper = std::min(nu[i], round_up(cu[i] + mu));
+    }
+
+    // Monotone on X: the range is spanned by the values at the end points
+    horner_enclosure(xl, xl, count, terms, cl, cu);
+    horner_enclosure(xu, xu, count, terms, el, eu);
+    for (size_t i = 0; i < count; ++i) {
+        if (dl[i] > 0 || du[i] < 0) {
+            out[i].lower = std::max(out[i].lower, std::min(cl[i], el[i]));
+            out[i].upper = std::min(out[i].upper, std::max(cu[i], eu[i]));
+        }
+    }
+}
+
+} // namespace detail
+
+// Enclosure of {p(x) : x in X}
+template<typename T, typename R>
+Interval<R> evaluate_interval(const Polynomial<T> &p, Interval<R> x) {
+    Interval<R> result;
+    detail::enclose_block(p, &x, 1, &result);
+    return result;
+}
+
+// Enclosures of p over count intervals, processed in blocks so that each
+// step of the evaluation runs over many intervals at once
+template<typename T, typename R>
+void evaluate_interval(const Polynomial<T> &p, const Interval<R> *x, size_t count, Interval<R> *out) {
+    const size_t block = 64;
+    for (size_t first = 0; first < count; first += block)
+        detail::enclose_block(p, x + first, std::min(block, count - first), out + first);
+}
@@ -0,0 +1,313 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "polynomial.h"
+#include "polynomial_fft.h"
+
+// Matrices with polynomial entries.
+//
+// Multiplying an r x m by an m x c matrix entry by entry takes r m c
+// polynomial products. Instead every entry of both operands is
+// transformed once to the values at N points, N above the degree of the
+// product, the r x c matrix products are computed point by point, and the
+// r c entries of the result are transformed back: r m + m c + r c
+// transforms, where multiplying each pair of entries through transforms
+// would take 3 r m c.
+//
+// Floating point entries use complex FFTs, and their results may differ
+// from operator* by rounding; coefficients below the rounding error of
+// the transforms are dropped. Signed integer entries use number theoretic
+// transforms modulo two primes, combined with the Chinese remainder
+// theorem, which is exact while the result coefficients are bounded well
+// below 2^58. Other coefficient types, results that could exceed that
+// bound, and sparse entries for which the transforms would cost more than
+// the products all use the entrywise product.
+
+template<typename T>
+class PolynomialMatrix {
+ private:
+    size_t n_rows = 0, n_cols = 0;
+    // Row-major entries
+    std::vector<Polynomial<T>> entries;
+
+    // sum_k lhs(i, k) * rhs(k, j) with operator*
+    static PolynomialMatrix multiply_entrywise(const PolynomialMatrix &lhs, const PolynomialMatrix &rhs) {
+        PolynomialMatrix result(lhs.n_rows, rhs.n_cols);
+        for (size_t i = 0; i < lhs.n_rows; ++i)
+            for (size_t k = 0; k < lhs.n_cols; ++k)
+                for (size_t j = 0; j < rhs.n_cols; ++j)
+                    result(i, j) += lhs(i, k) * rhs(k, j);
+        return result;
+    }
+
+    unsigned max_degree() const {
+        unsigned result = 0;
+        for (auto &p : entries)
+            result = std::max(result, p.degree());
+        return result;
+    }
+
+    // Whether transforms of length n beat the entrywise products, with a
+    // map update counted as a few transform steps
+    static bool transforms_pay_off(const PolynomialMatrix &lhs, const PolynomialMatrix &rhs, size_t n) {
+        size_t r = lhs.n_rows, m = lhs.n_cols, c = rhs.n_cols;
+        double products = 0;
+        for (size_t k = 0; k < m; ++k) {
+            double column = 0, row = 0;
+            for (size_t i = 0; i < r; ++i)
+                column += double(lhs(i, k).length());
+            for (size_t j = 0; j < c; ++j)
+                row += double(rhs(k, j).length());
+            products += column * row;
+        }
+        double transforms = double(n) * (double(r) * m * c + double(r * m + m * c + r * c) * std::log2(double(n)));
+        return transforms < 4 * products;
+    }
+
+    template<typename R>
+    static PolynomialMatrix multiply_fft(const PolynomialMatrix &lhs, const PolynomialMatrix &rhs, size_t n) {
+        size_t r = lhs.n_rows, m = lhs.n_cols, c = rhs.n_cols;
+        auto forward = detail::fft_roots<R>(n, false), inverse = detail::fft_roots<R>(n, true);
+        std::vector<std::complex<R>> buffer(n);
+
+        // Values of the entries at the n points, point-major so that each
+        // point's matrix is contiguous
+        auto transform = [&](const PolynomialMatrix &a, std::vector<std::complex<R>> &values) {
+            size_t count = a.entries.size();
+            values.assign(n * count, std::complex<R>());
+            for (size_t e = 0; e < count; ++e) {
+                std::fill(buffer.begin(), buffer.end(), std::complex<R>());
+                for (auto &term : a.entries[e])
+                    buffer[term.first] = std::complex<R>(R(term.second));
+                detail::fft(buffer, forward);
+                for (size_t t = 0; t < n; ++t)
+                    values[t * count + e] = buffer[t];
+            }
+        };
+        std::vector<std::complex<R>> a, b, products(n * r * c);
+        transform(lhs, a);
+        transform(rhs, b);
+
+        for (size_t t = 0; t < n; ++t) {
+            const std::complex<R> *at = &a[t * r * m], *bt = &b[t * m * c];
+            std::complex<R> *pt = &products[t * r * c];
+            for (size_t i = 0; i < r; ++i) {
+                for (size_t k = 0; k < m; ++k) {
+                    std::complex<R> x = at[i * m + k];
+                    for (size_t j = 0; j < c; ++j)
+                        pt[i * c + j] += detail::complex_multiply(x, bt[k * c + j]);
+                }
+            }
+        }
+
+        // The error of a transform product is about eps log2(n) |a|_2 |b|_2
+        auto norm = [](const Polynomial<T> &p) {
+            R sum = 0;
+            for (auto &term : p)
+                sum += R(term.second) * R(term.second);
+            return std::sqrt(sum);
+        };
+        std::vector<R> lhs_norms, rhs_norms;
+        for (auto &p : lhs.entries)
+            lhs_norms.push_back(norm(p));
+        for (auto &p : rhs.entries)
+            rhs_norms.push_back(norm(p));
+
+        PolynomialMatrix result(r, c);
+        for (size_t i = 0; i < r; ++i) {
+            for (size_t j = 0; j < c; ++j) {
+                R bound = 0;
+                for (size_t k = 0; k < m; ++k)
+                    bound += lhs_norms[i * m + k] * rhs_norms[k * c + j];
+                R threshold = 4 * std::numeric_limits<R>::epsilon() * std::log2(R(n)) * bound;
+
+                for (size_t t = 0; t < n; ++t)
+                    buffer[t] = products[t * r * c + i * c + j];
+                detail::fft(buffer, inverse);
+                Polynomial<T> &entry = result(i, j);
+                for (size_t e = 0; e < n; ++e) {
+                    R value = buffer[e].real() / R(n);
+                    if (std::fabs(value) > threshold)
+                        entry.add_term(unsigned(e), T(value));
+                }
+            }
+        }
+        return result;
+    }
+
+    static PolynomialMatrix multiply_ntt(const PolynomialMatrix &lhs, const PolynomialMatrix &rhs, size_t n) {
+        size_t r = lhs.n_rows, m = lhs.n_cols, c = rhs.n_cols;
+        std::vector<uint64_t> residues[2];
+
+        for (int q = 0; q < 2; ++q) {
+            const detail::NttPrime &prime = detail::ntt_primes[q];
+            uint64_t p = prime.modulus;
+            auto forward = detail::ntt_roots(n, prime, false), inverse = detail::ntt_roots(n, prime, true);
+            std::vector<uint64_t> buffer(n);
+
+            auto transform = [&](const PolynomialMatrix &a, std::vector<uint64_t> &values) {
+                size_t count = a.entries.size();
+                values.assign(n * count, 0);
+                for (size_t e = 0; e < count; ++e) {
+                    std::fill(buffer.begin(), buffer.end(), 0);
+                    for (auto &term : a.entries[e]) {
+                        long long coefficient = (long long)term.second % (long long)p;
+                        buffer[term.first] = uint64_t(coefficient < 0 ? coefficient + (long long)p : coefficient);
+                    }
+                    detail::ntt(buffer, forward, p);
+                    for (size_t t = 0; t < n; ++t)
+                        values[t * count + e] = buffer[t];
+                }
+            };
+            std::vector<uint64_t> a, b, products(n * r * c, 0);
+            transform(lhs, a);
+            transform(rhs, b);
+
+            for (size_t t = 0; t < n; ++t) {
+                const uint64_t *at = &a[t * r * m], *bt = &b[t * m * c];
+                uint64_t *pt = &products[t * r * c];
+                for (size_t i = 0; i < r; ++i) {
+                    for (size_t k = 0; k < m; ++k) {
+                        uint64_t x = at[i * m + k];
+                        for (size_t j = 0; j < c; ++j)
+                            pt[i * c + j] = (pt[i * c + j] + x * bt[k * c + j]) % p;
+                    }
+                }
+            }
+
+            uint64_t n_inverse = detail::power_mod(n, p - 2, p);
+            residues[q].resize(n * r * c);
+            for (size_t e = 0; e < r * c; ++e) {
+                for (size_t t = 0; t < n; ++t)
+                    buffer[t] = products[t * r * c + e];
+                detail::ntt(buffer, inverse, p);
+                for (size_t t = 0; t < n; ++t)
+                    residues[q][e * n + t] = buffer[t] * n_inverse % p;
+            }
+        }
+
+        // x = x0 + p0 ((x1 - x0) p0^-1 mod p1), taken in (-p0 p1 / 2, p0 p1 / 2]
+        uint64_t p0 = detail::ntt_primes[0].modulus, p1 = detail::ntt_primes[1].modulus;
+        uint64_t p0_inverse = detail::power_mod(p0, p1 - 2, p1), modulus = p0 * p1;
+        PolynomialMatrix result(r, c);
+        for (size_t e = 0; e < r * c; ++e) {
+            Polynomial<T> &entry = result.entries[e];
+            for (size_t t = 0; t < n; ++t) {
+                uint64_t x0 = residues[0][e * n + t], x1 = residues[1][e * n + t];
+                uint64_t h = (x1 + p1 - x0 % p1) % p1 * p0_inverse % p1;
+                uint64_t x = x0 + p0 * h;
+                long long value = x > modulus / 2 ? -(long long)(modulus - x) : (long long)x;
+                if (value != 0)
+                    entry.add_term(unsigned(t), T(value));
+            }
+        }
+        return result;
+    }
+
+    // Bound of the absolute values of the coefficients of the product
+    static long double coefficient_bound(const PolynomialMatrix &lhs, const PolynomialMatrix &rhs) {
+        auto largest = [](const PolynomialMatrix &a) {
+            long double result = 0;
+            size_t length = 0;
+            for (auto &p : a.entries) {
+                length = std::max(length, p.length());
+                for (auto &term : p)
+                    result = std::max(result, std::fabs((long double)term.second));
+            }
+            return std::make_pair(result, length);
+        };
+        auto a = largest(lhs), b = largest(rhs);
+        return (long double)lhs.n_cols * std::min(a.second, b.second) * a.first * b.first;
+    }
+
+ public:
+    PolynomialMatrix() = default;
+
+    // Zero matrix
+    PolynomialMatrix(size_t rows, size_t cols) : n_rows(rows), n_cols(cols), entries(rows * cols)
+    {}
+
+    // Entries row by row, e.g. {{p, q}, {r, s}}
+    PolynomialMatrix(std::initializer_list<std::initializer_list<Polynomial<T>>> rows)
+        : n_rows(rows.size()), n_cols(rows.size() ? rows.begin()->size() : 0) {
+        for (auto &row : rows) {
+            if (row.size() != n_cols)
+                throw std::invalid_argument("PolynomialMatrix: rows differ in length");
+            entries.insert(entries.end(), row.begin(), row.end());
+        }
+    }
+
+    static PolynomialMatrix identity(size_t n) {
+        PolynomialMatrix result(n, n);
+        for (size_t i = 0; i < n; ++i)
+            result(i, i) = Polynomial<T>(T(1));
+        return result;
+    }
+
+    size_t rows() const {
+        return n_rows;
+    }
+
+    size_t cols() const {
+        return n_cols;
+    }
+
+    Polynomial<T> &operator() (size_t i, size_t j) {
+        return entries[i * n_cols + j];
+    }
+
+    const Polynomial<T> &operator() (size_t i, size_t j) const {
+        return entries[i * n_cols + j];
+    }
+
+    friend PolynomialMatrix operator+ (PolynomialMatrix lhs, const PolynomialMatrix &rhs) {
+        if (lhs.n_rows != rhs.n_rows || lhs.n_cols != rhs.n_cols)
+            throw std::invalid_argument("PolynomialMatrix: dimensions don't match");
+        for (size_t e = 0; e < lhs.entries.size(); ++e)
+            lhs.entries[e] += rhs.entries[e];
+        return lhs;
+    }
+
+    friend PolynomialMatrix operator- (PolynomialMatrix lhs, const PolynomialMatrix &rhs) {
+        if (lhs.n_rows != rhs.n_rows || lhs.n_cols != rhs.n_cols)
+            throw std::invalid_argument("PolynomialMatrix: dimensions don't match");
+        for (size_t e = 0; e < lhs.entries.size(); ++e)
+            lhs.entries[e] -= rhs.entries[e];
+        return lhs;
+    }
+
+    friend PolynomialMatrix operator* (const PolynomialMatrix &lhs, const PolynomialMatrix &rhs) {
+        if (lhs.n_cols != rhs.n_rows)
+            throw std::invalid_argument("PolynomialMatrix: dimensions don't match");
+
+        size_t n = detail::fft_size(size_t(lhs.max_degree()) + rhs.max_degree() + 1);
+        if constexpr (std::is_floating_point<T>::value) {
+            if (transforms_pay_off(lhs, rhs, n))
+                return multiply_fft<T>(lhs, rhs, n);
+        } else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+            // Keep |result| below p0 p1 / 2, about 2^57.7
+            if (n <= (size_t(1) << detail::ntt_primes[0].max_log_size) &&
+                coefficient_bound(lhs, rhs) < (long double)(uint64_t(1) << 57) &&
+                transforms_pay_off(lhs, rhs, n))
+                return multiply_ntt(lhs, rhs, n);
+        }
+        return multiply_entrywise(lhs, rhs);
+    }
+
+    bool operator== (PolynomialMatrix const &other) const {
+        return n_rows == other.n_rows && n_cols == other.n_cols && entries == other.entries;
+    }
+
+    bool operator!= (PolynomialMatrix const &other) const {
+        return !(*this == other);
+    }
+};
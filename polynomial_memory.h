@@ -0,0 +1,199 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include "polynomial.h"
+
+// Memory management for short-lived polynomials.
+//
+// Polynomials allocate their terms from the memory resource of the thread
+// they are constructed on (see PolynomialResourceScope in polynomial.h).
+// Temporaries created while evaluating an expression such as
+// 4.5*x*x - 7.1*x + 0.5 can be placed in an arena or a thread-local pool
+// instead of going through malloc for every term.
+//
+// A polynomial that allocated from an arena or pool must not outlive it.
+// To keep a result, assign it to a polynomial constructed outside of the
+// scope: assignment keeps the memory resource of the target and copies
+// the terms over.
+
+// Monotonic arena: allocation bumps a pointer, deallocation is a no-op and
+// all memory is released at once when the arena is destroyed. Polynomials
+// constructed on this thread allocate from the arena while it is alive.
+class PolynomialArena {
+ private:
+    std::pmr::monotonic_buffer_resource resource;
+    PolynomialResourceScope scope;
+
+ public:
+    explicit PolynomialArena(size_t initial_size = 4096)
+        : resource(initial_size), scope(&resource)
+    {}
+
+    // Start by allocating from a caller-supplied buffer, e.g. on the stack
+    PolynomialArena(void *buffer, size_t size)
+        : resource(buffer, size), scope(&resource)
+    {}
+
+    std::pmr::memory_resource *get() {
+        return &resource;
+    }
+};
+
+// Per-thread pool that recycles freed map nodes. Unsynchronized, so the
+// polynomials using it must be destroyed on the thread that created them.
+inline std::pmr::memory_resource *thread_polynomial_pool() {
+    static thread_local std::pmr::unsynchronized_pool_resource pool;
+    return &pool;
+}
+
+// Polynomials constructed on this thread allocate from the thread-local
+// pool while the scope is alive
+class PolynomialPoolScope {
+ private:
+    PolynomialResourceScope scope;
+
+ public:
+    PolynomialPoolScope() : scope(thread_polynomial_pool())
+    {}
+};
+
+// Allocation tracking.
+//
+// While an AllocationTrackingScope is alive, polynomials constructed on
+// the thread allocate through a tracking resource that records the
+// number of allocations and the allocated, live and peak bytes, both for
+// the thread and for every enclosing tracking scope. Memory is still
+// taken from the resource that was in use when the outermost scope was
+// opened, e.g. an enclosing arena. Arena or pool scopes opened inside a
+// tracking scope bypass the tracking.
+//
+// Live bytes count allocations minus deallocations on the thread while
+// the scope is open, so memory still live when the scope closes belongs
+// to polynomials that escaped it.
+
+struct AllocationStats {
+    size_t allocations = 0;
+    size_t deallocations = 0;
+    size_t bytes_allocated = 0;
+    long long live_bytes = 0;
+    long long peak_bytes = 0;
+};
+
+namespace detail {
+
+struct TrackingScopeNode {
+    AllocationStats stats;
+    std::pmr::memory_resource *upstream;
+    TrackingScopeNode *parent;
+};
+
+inline TrackingScopeNode *&tracking_scope_top() {
+    static thread_local TrackingScopeNode *top = nullptr;
+    return top;
+}
+
+inline AllocationStats &thread_allocation_stats_ref() {
+    static thread_local AllocationStats stats;
+    return stats;
+}
+
+inline void record_allocation(AllocationStats &stats, size_t bytes) {
+    stats.allocations++;
+    stats.bytes_allocated += bytes;
+    stats.live_bytes += bytes;
+    if (stats.live_bytes > stats.peak_bytes)
+        stats.peak_bytes = stats.live_bytes;
+}
+
+inline void record_deallocation(AllocationStats &stats, size_t bytes) {
+    stats.deallocations++;
+    stats.live_bytes -= bytes;
+}
+
+// Forwards to the upstream resource of the innermost tracking scope. The
+// upstream is stored in a header in front of each block, so blocks can be
+// released after their scope has closed, and from any thread.
+class TrackingResource : public std::pmr::memory_resource {
+ private:
+    static size_t header_size(size_t alignment) {
+        size_t size = sizeof(std::pmr::memory_resource *);
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    static size_t block_alignment(size_t alignment) {
+        return std::max(alignment, alignof(std::pmr::memory_resource *));
+    }
+
+    void *do_allocate(size_t bytes, size_t alignment) override {
+        TrackingScopeNode *top = tracking_scope_top();
+        std::pmr::memory_resource *upstream = top ? top->upstream : polynomial_default_resource();
+
+        size_t header = header_size(block_alignment(alignment));
+        char *block = static_cast<char *>(upstream->allocate(bytes + header, block_alignment(alignment)));
+        char *p = block + header;
+        std::memcpy(p - sizeof(upstream), &upstream, sizeof(upstream));
+
+        record_allocation(thread_allocation_stats_ref(), bytes);
+        for (auto scope = top; scope; scope = scope->parent)
+            record_allocation(scope->stats, bytes);
+        return p;
+    }
+
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+        std::pmr::memory_resource *upstream;
+        std::memcpy(&upstream, static_cast<char *>(p) - sizeof(upstream), sizeof(upstream));
+
+        size_t header = header_size(block_alignment(alignment));
+        upstream->deallocate(static_cast<char *>(p) - header, bytes + header, block_alignment(alignment));
+
+        record_deallocation(thread_allocation_stats_ref(), bytes);
+        for (auto scope = tracking_scope_top(); scope; scope = scope->parent)
+            record_deallocation(scope->stats, bytes);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+} // namespace detail
+
+inline std::pmr::memory_resource *polynomial_tracking_resource() {
+    static detail::TrackingResource resource;
+    return &resource;
+}
+
+// Allocations of the calling thread made through the tracking resource
+inline AllocationStats thread_allocation_stats() {
+    return detail::thread_allocation_stats_ref();
+}
+
+class AllocationTrackingScope {
+ private:
+    detail::TrackingScopeNode node;
+    PolynomialResourceScope scope;
+
+ public:
+    AllocationTrackingScope()
+        : node{AllocationStats(),
+               polynomial_memory_resource() == polynomial_tracking_resource()
+                   ? detail::tracking_scope_top()->upstream
+                   : polynomial_memory_resource(),
+               detail::tracking_scope_top()},
+          scope(polynomial_tracking_resource()) {
+        detail::tracking_scope_top() = &node;
+    }
+
+    AllocationTrackingScope(AllocationTrackingScope const &) = delete;
+    AllocationTrackingScope &operator= (AllocationTrackingScope const &) = delete;
+
+    ~AllocationTrackingScope() {
+        detail::tracking_scope_top() = node.parent;
+    }
+
+    const AllocationStats &stats() const {
+        return node.stats;
+    }
+};
@@ -0,0 +1,368 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iosfwd>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "polynomial.h"
+
+// Sparse polynomials in NVars variables.
+//
+// The exponents of a monomial are packed into one 64-bit word, with
+// 64 / NVars bits per variable and the first variable in the highest
+// bits, so that comparing words orders monomials lexicographically and
+// adding words multiplies monomials. The top bit of every field is kept
+// clear, which limits exponents to 2^(64 / NVars - 1) - 1, e.g. 2^31 - 1
+// for two variables and 127 for eight; operations that would exceed the
+// limit throw std::overflow_error.
+//
+// Terms are kept in a vector sorted by monomial. Products are computed
+// with Johnson's heap method: a heap holds the next product of each term
+// of the shorter operand with the terms of the other, so the products
+// come out in sorted order and are merged as they are produced, without
+// sorting or a map.
+
+template<typename T, size_t NVars>
+class MultiPolynomial {
+    static_assert(NVars >= 1 && NVars <= 32, "MultiPolynomial supports 1 to 32 variables");
+
+ public:
+    typedef std::array<unsigned, NVars> Exponents;
+
+    static constexpr unsigned field_bits = unsigned(64 / NVars);
+    static constexpr uint64_t max_exponent = std::min<uint64_t>((uint64_t(1) << (field_bits - 1)) - 1,
+                                                                std::numeric_limits<unsigned>::max());
+
+    struct Term {
+        uint64_t monomial;
+        T coefficient;
+
+        Exponents exponents() const {
+            return unpack(monomial);
+        }
+    };
+
+    typedef typename std::vector<Term>::const_iterator const_iterator;
+
+ private:
+    // Terms in ascending order of monomial, without zero coefficients
+    std::vector<Term> terms;
+
+    static unsigned shift(size_t var) {
+        return unsigned(field_bits * (NVars - 1 - var));
+    }
+
+    static uint64_t field_mask() {
+        return field_bits == 64 ? ~uint64_t(0) : (uint64_t(1) << field_bits % 64) - 1;
+    }
+
+    // Largest exponent of each variable
+    Exponents degrees() const {
+        Exponents result{};
+        for (auto &term : terms)
+            for (size_t v = 0; v < NVars; ++v)
+                result[v] = std::max(result[v], unsigned(term.monomial >> shift(v) & field_mask()));
+        return result;
+    }
+
+    template<typename Combine>
+    static MultiPolynomial merge(const MultiPolynomial &lhs, const MultiPolynomial &rhs, Combine combine) {
+        MultiPolynomial result;
+        result.terms.reserve(lhs.terms.size() + rhs.terms.size());
+        auto a = lhs.terms.begin(), b = rhs.terms.begin();
+        while (a != lhs.terms.end() || b != rhs.terms.end()) {
+            if (b == rhs.terms.end() || (a != lhs.terms.end() && a->monomial < b->monomial)) {
+                result.terms.push_back(*a++);
+            } else if (a == lhs.terms.end() || b->monomial < a->monomial) {
+                result.terms.push_back({b->monomial, combine(T(), b->coefficient)});
+                ++b;
+            } else {
+                T c = combine(a->coefficient, b->coefficient);
+                if (c != T())
+                    result.terms.push_back({a->monomial, c});
+                ++a;
+                ++b;
+            }
+        }
+        return result;
+    }
+
+ public:
+    MultiPolynomial() = default;
+
+    // Enable implicit conversion from coefficient type to constant term
+    MultiPolynomial(T value) {
+        if (value != T())
+            terms.push_back({0, value});
+    }
+
+    // Terms given as (exponents, coefficient) pairs in any order
+    MultiPolynomial(std::initializer_list<std::pair<Exponents, T>> list) {
+        for (auto &term : list)
+            add_term(term.first, term.second);
+    }
+
+    // The polynomial x_var
+    static MultiPolynomial Variable(size_t var) {
+        if (var >= NVars)
+            throw std::out_of_range("MultiPolynomial: no such variable");
+        Exponents e{};
+        e[var] = 1;
+        MultiPolynomial result;
+        result.terms.push_back({pack(e), T(1)});
+        return result;
+    }
+
+    static uint64_t pack(const Exponents &exponents) {
+        uint64_t monomial = 0;
+        for (size_t v = 0; v < NVars; ++v) {
+            if (exponents[v] > max_exponent)
+                throw std::overflow_error("MultiPolynomial: exponent too large to pack");
+            monomial |= uint64_t(exponents[v]) << shift(v);
+        }
+        return monomial;
+    }
+
+    static Exponents unpack(uint64_t monomial) {
+        Exponents exponents;
+        for (size_t v = 0; v < NVars; ++v)
+            exponents[v] = unsigned(monomial >> shift(v) & field_mask());
+        return exponents;
+    }
+
+    size_t length() const {
+        return terms.size();
+    }
+
+    // Highest total degree of a term, 0 for the zero polynomial
+    unsigned degree() const {
+        unsigned result = 0;
+        for (auto &term : terms) {
+            unsigned total = 0;
+            for (unsigned e : term.exponents())
+                total += e;
+            result = std::max(result, total);
+        }
+        return result;
+    }
+
+    T coefficient(const Exponents &exponents) const {
+        uint64_t monomial = pack(exponents);
+        auto it = std::lower_bound(terms.begin(), terms.end(), monomial, [](const Term &term, uint64_t m) {
+            return term.monomial < m;
+        });
+        return it != terms.end() && it->monomial == monomial ? it->coefficient : T();
+    }
+
+    // Read-only iteration over terms in ascending lexicographic order
+    const_iterator begin() const {
+        return terms.begin();
+    }
+
+    const_iterator end() const {
+        return terms.end();
+    }
+
+    // Accumulate a term. Appending in ascending order takes amortized
+    // constant time, other positions are inserted into the vector.
+    void add_term(const Exponents &exponents, T coefficient) {
+        uint64_t monomial = pack(exponents);
+        auto it = terms.end();
+        if (!terms.empty() && terms.back().monomial >= monomial) {
+            it = std::lower_bound(terms.begin(), terms.end(), monomial, [](const Term &term, uint64_t m) {
+                return term.monomial < m;
+            });
+        }
+        if (it != terms.end() && it->monomial == monomial) {
+            it->coefficient += coefficient;
+            if (it->coefficient == T())
+                terms.erase(it);
+        } else if (coefficient != T()) {
+            terms.insert(it, {monomial, coefficient});
+        }
+    }
+
+    friend MultiPolynomial operator+ (const MultiPolynomial &lhs, const MultiPolynomial &rhs) {
+        return merge(lhs, rhs, [](const T &a, const T &b) { return a + b; });
+    }
+
+    friend MultiPolynomial operator- (const MultiPolynomial &lhs, const MultiPolynomial &rhs) {
+        return merge(lhs, rhs, [](const T &a, const T &b) { return a - b; });
+    }
+
+    MultiPolynomial operator- () const {
+        MultiPolynomial result(*this);
+        for (auto &term : result.terms)
+            term.coefficient = -term.coefficient;
+        return result;
+    }
+
+    friend MultiPolynomial operator* (const MultiPolynomial &lhs, const MultiPolynomial &rhs) {
+        if (lhs.terms.empty() || rhs.terms.empty())
+            return MultiPolynomial();
+
+        // Exponents of products are bounded by the sums of the largest
+        // exponents, so no field can carry into the next
+        Exponents a = lhs.degrees(), b = rhs.degrees();
+        for (size_t v = 0; v < NVars; ++v)
+            if (uint64_t(a[v]) + b[v] > max_exponent)
+                throw std::overflow_error("MultiPolynomial: product exponent too large to pack");
+
+        const std::vector<Term> &outer = lhs.terms.size() <= rhs.terms.size() ? lhs.terms : rhs.terms;
+        const std::vector<Term> &inner = lhs.terms.size() <= rhs.terms.size() ? rhs.terms : lhs.terms;
+        bool outer_is_lhs = &outer == &lhs.terms;
+
+        // Min-heap of (monomial of outer[i] * inner[j[i]], i)
+        struct Entry {
+            uint64_t monomial;
+            size_t i;
+        };
+        auto later = [](const Entry &x, const Entry &y) {
+            return x.monomial > y.monomial || (x.monomial == y.monomial && x.i > y.i);
+        };
+        std::vector<size_t> next(outer.size(), 0);
+        std::vector<Entry> heap;
+        heap.reserve(outer.size());
+        for (size_t i = 0; i < outer.size(); ++i)
+            heap.push_back({outer[i].monomial + inner[0].monomial, i});
+        std::make_heap(heap.begin(), heap.end(), later);
+
+        MultiPolynomial result;
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            Entry entry = heap.back();
+            heap.pop_back();
+
+            size_t i = entry.i, j = next[i]++;
+            T product = outer_is_lhs ? outer[i].coefficient * inner[j].coefficient
+                                     : inner[j].coefficient * outer[i].coefficient;
+            if (!result.terms.empty() && result.terms.back().monomial == entry.monomial) {
+                result.terms.back().coefficient += product;
+            } else {
+                if (!result.terms.empty() && result.terms.back().coefficient == T())
+                    result.terms.pop_back();
+                result.terms.push_back({entry.monomial, product});
+            }
+
+            if (next[i] < inner.size()) {
+                heap.push_back({outer[i].monomial + inner[next[i]].monomial, i});
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+        }
+        if (!result.terms.empty() && result.terms.back().coefficient == T())
+            result.terms.pop_back();
+        return result;
+    }
+
+    MultiPolynomial &operator+= (const MultiPolynomial &rhs) {
+        return *this = *this + rhs;
+    }
+
+    MultiPolynomial &operator-= (const MultiPolynomial &rhs) {
+        return *this = *this - rhs;
+    }
+
+    MultiPolynomial &operator*= (const MultiPolynomial &rhs) {
+        return *this = *this * rhs;
+    }
+
+    // Partial derivative with respect to x_var
+    MultiPolynomial differentiate(size_t var) const {
+        if (var >= NVars)
+            throw std::out_of_range("MultiPolynomial: no such variable");
+
+        // Lowering the same field of every term keeps them in order
+        uint64_t unit = uint64_t(1) << shift(var);
+        MultiPolynomial result;
+        for (auto &term : terms) {
+            unsigned e = unsigned(term.monomial >> shift(var) & field_mask());
+            if (e > 0) {
+                T coefficient = term.coefficient;
+                coefficient *= e;
+                if (coefficient != T())
+                    result.terms.push_back({term.monomial - unit, coefficient});
+            }
+        }
+        return result;
+    }
+
+    bool operator== (MultiPolynomial const &other) const {
+        return terms.size() == other.terms.size() &&
+               std::equal(terms.begin(), terms.end(), other.terms.begin(), [](const Term &a, const Term &b) {
+                   return a.monomial == b.monomial && a.coefficient == b.coefficient;
+               });
+    }
+
+    bool operator!= (MultiPolynomial const &other) const {
+        return !(*this == other);
+    }
+
+    // evaluate the polynomial at a point, with the powers of each
+    // coordinate computed once up to the largest exponent
+    template<typename U>
+    U operator() (const std::array<U, NVars> &point) const {
+        Exponents d = degrees();
+        std::array<std::vector<U>, NVars> powers;
+        for (size_t v = 0; v < NVars; ++v) {
+            powers[v].resize(size_t(d[v]) + 1);
+            powers[v][0] = U(1);
+            for (unsigned e = 1; e <= d[v]; ++e)
+                powers[v][e] = powers[v][e - 1] * point[v];
+        }
+
+        U result = U();
+        for (auto &term : terms) {
+            U value = U(term.coefficient);
+            for (size_t v = 0; v < NVars; ++v) {
+                unsigned e = unsigned(term.monomial >> shift(v) & field_mask());
+                if (e > 0)
+                    value *= powers[v][e];
+            }
+            result += value;
+        }
+        return result;
+    }
+
+    // Print in descending lexicographic order, with variables named x, y
+    // and z for up to three variables and x1, x2, ... otherwise
+    void print(std::ostream& os) const {
+        std::array<std::string, NVars> names;
+        for (size_t v = 0; v < NVars; ++v)
+            names[v] = NVars <= 3 ? std::string(1, "xyz"[v]) : "x" + std::to_string(v + 1);
+        print(os, names);
+    }
+
+    void print(std::ostream& os, const std::array<std::string, NVars> &names) const {
+        if (terms.empty()) {
+            os << T();
+            return;
+        }
+
+        for (auto it = terms.rbegin(); it != terms.rend(); ++it) {
+            if (it == terms.rbegin())
+                os << it->coefficient;
+            else
+                os << (tSign(it->coefficient) ? " - " : " + ") << tAbs(it->coefficient);
+
+            Exponents e = it->exponents();
+            for (size_t v = 0; v < NVars; ++v) {
+                if (e[v] > 0)
+                    os << names[v];
+                if (e[v] > 1)
+                    os << "^" << e[v];
+            }
+        }
+    }
+};
+
+template<typename T, size_t NVars>
+std::ostream& operator<< (std::ostream& os, MultiPolynomial<T, NVars> const &p) {
+    p.print(os);
+    return os;
+}
@@ -0,0 +1,207 @@
+#pragma once
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include "polynomial.h"
+#include "polynomial_parallel.h"
+#include "polynomial_stream.h"
+
+// Multiplication of polynomials in coefficient streams that are too large
+// to multiply in memory.
+//
+// The lhs stream is read once, in tiles that fit the memory budget. For
+// every lhs tile the rhs stream is read again from its file, also in
+// tiles, and each pair of tiles is multiplied with the block kernel of
+// multiply(). Output terms below the lowest exponent the remaining rhs
+// terms can reach are final: they are merged with the sum of the products
+// of the previous lhs tiles, which is kept in a temporary stream on disk,
+// and written out. The product of the last lhs tile is merged straight
+// into the output stream. Product terms that aren't final yet are held in
+// a bounded accumulator; sparse products that overflow it are computed in
+// several windows of output exponents, rereading the rhs stream for each.
+
+namespace detail {
+
+struct FileCloser {
+    void operator()(std::FILE *file) const {
+        std::fclose(file);
+    }
+};
+
+typedef std::unique_ptr<std::FILE, FileCloser> TemporaryFile;
+
+inline TemporaryFile temporary_file() {
+    TemporaryFile file(std::tmpfile());
+    if (!file)
+        throw stream_error("stream_multiply: cannot create temporary file");
+    return file;
+}
+
+// Read up to max_terms terms of a stream into tile, returns false at the
+// end of the stream
+template<typename T>
+bool read_tile(TermCursor<T> &cursor, TermArrays<T> &tile, size_t max_terms) {
+    tile.clear();
+    for (; !cursor.done() && tile.size() < max_terms; cursor.next_term()) {
+        tile.exponents.push_back(cursor.exponent());
+        tile.coefficients.push_back(cursor.coefficient());
+    }
+    return tile.size() > 0;
+}
+
+// Write the product of the lhs tile and the rhs stream plus the terms of
+// previous, if any, to out.
+//
+// Product terms that can still receive contributions are kept in a map of
+// at most pending_limit terms. When a new term would exceed that, the
+// upper half of the map is dropped and its exponents are left for a later
+// pass over the rhs stream, so the output is produced in windows of
+// exponents. Each window reads the rhs stream up to the last term that
+// can reach it.
+template<typename T>
+void multiply_tile(const TermArrays<T> &lhs, const std::string &rhs_path,
+                   size_t tile_terms, unsigned long long dense_limit, size_t pending_limit,
+                   CoefficientReader<T> *previous, CoefficientWriter<T> &out) {
+    const unsigned long long end = std::numeric_limits<unsigned long long>::max();
+
+    std::optional<TermCursor<T>> sum;
+    if (previous)
+        sum.emplace(*previous);
+
+    // Product terms in [window_lo, window_hi), allocated like the terms of
+    // a polynomial so that allocation tracking scopes include them
+    std::pmr::map<unsigned, T> pending(polynomial_memory_resource());
+    unsigned long long window_lo = 0, window_hi = end;
+
+    // Write the pending and previous terms with exponents below limit
+    auto write_below = [&](unsigned long long limit) {
+        auto it = pending.begin();
+        while (true) {
+            bool from_pending = it != pending.end() && it->first < limit;
+            bool from_sum = sum && !sum->done() && sum->exponent() < limit;
+            if (from_pending && (!from_sum || it->first < sum->exponent())) {
+                out.write(it->first, it->second);
+                ++it;
+            } else if (from_sum && (!from_pending || sum->exponent() < it->first)) {
+                out.write(sum->exponent(), sum->coefficient());
+                sum->next_term();
+            } else if (from_pending) {
+                out.write(it->first, sum->coefficient() + it->second);
+                sum->next_term();
+                ++it;
+            } else {
+                break;
+            }
+        }
+        pending.erase(pending.begin(), it);
+    };
+
+    auto add = [&](unsigned long long e, const T &c) {
+        if (e < window_lo || e >= window_hi)
+            return;
+        auto inserted = pending.try_emplace(unsigned(e), c);
+        if (!inserted.second) {
+            inserted.first->second += c;
+        } else if (pending.size() > pending_limit) {
+            auto middle = std::next(pending.begin(), pending.size() / 2);
+            window_hi = middle->first;
+            pending.erase(middle, pending.end());
+        }
+    };
+
+    while (true) {
+        CoefficientReader<T> rhs_reader(rhs_path);
+        TermCursor<T> rhs(rhs_reader);
+        TermArrays<T> tile;
+        while (read_tile(rhs, tile, tile_terms)) {
+            unsigned long long lo = std::max(window_lo, (unsigned long long)lhs.exponents.front() + tile.exponents.front());
+            unsigned long long hi = std::min(window_hi, (unsigned long long)lhs.exponents.back() + tile.exponents.back() + 1);
+            unsigned long long products = (unsigned long long)lhs.size() * tile.size();
+            if (lo < hi && hi - lo <= dense_limit && hi - lo <= 4 * products) {
+                multiply_block(lhs, tile, lo, hi, true, [&](unsigned e, const T &c) {
+                    add(e, c);
+                });
+            } else if (lo < hi) {
+                // Products straight into the map, stopping at the window,
+                // which may shrink on the way
+                for (size_t i = 0; i < lhs.size(); ++i) {
+                    unsigned long long e1 = lhs.exponents[i];
+                    if (e1 + tile.exponents.front() >= window_hi)
+                        break;
+                    unsigned long long min_e2 = lo > e1 ? lo - e1 : 0;
+                    auto first = std::lower_bound(tile.exponents.begin(), tile.exponents.end(), min_e2);
+                    for (size_t j = first - tile.exponents.begin(); j < tile.size(); ++j) {
+                        unsigned long long k = e1 + tile.exponents[j];
+                        if (k >= window_hi)
+                            break;
+                        add(k, lhs.coefficients[i] * tile.coefficients[j]);
+                    }
+                }
+            }
+
+            // The remaining rhs terms only reach exponents from here on
+            unsigned long long reach = rhs.done() ? end : (unsigned long long)lhs.exponents.front() + rhs.exponent();
+            write_below(std::min(reach, window_hi));
+            if (reach >= window_hi)
+                break;
+        }
+        write_below(window_hi);
+        if (window_hi == end)
+            break;
+        window_lo = window_hi;
+        window_hi = end;
+    }
+}
+
+} // namespace detail
+
+// Out-of-core lhs * rhs. The lhs stream is read once and the rhs stream
+// is reopened from rhs_path for every lhs tile and output window. Tiles,
+// accumulators and stream buffers are sized to stay within memory_budget
+// bytes, besides the chunks of the input streams. Floating point results
+// may differ from operator* by rounding, as the terms are summed tile by
+// tile.
+template<typename T>
+void stream_multiply(CoefficientReader<T> &lhs, const std::string &rhs_path,
+                     CoefficientWriter<T> &out, size_t memory_budget = size_t(1) << 28) {
+    // Half of the budget for the two tiles and the output buffer, an eighth
+    // for a dense block accumulator, and the rest for pending terms, at
+    // about the size of a map node each, but at least two
+    size_t tile_terms = memory_budget / (6 * (sizeof(unsigned) + sizeof(T)));
+    const size_t node_size = 4 * sizeof(void *) + sizeof(std::pair<const unsigned, T>);
+    size_t pending_limit = std::max<size_t>(2, memory_budget * 3 / (8 * node_size));
+    if (tile_terms == 0)
+        throw std::invalid_argument("stream_multiply: memory budget too small");
+    unsigned long long dense_limit = memory_budget / (8 * sizeof(T));
+    size_t chunk_terms = std::min<size_t>(tile_terms, 1 << 16);
+
+    detail::TermCursor<T> cursor(lhs);
+    detail::TermArrays<T> tile;
+    detail::TemporaryFile sum;
+    while (detail::read_tile(cursor, tile, tile_terms)) {
+        std::optional<CoefficientReader<T>> previous;
+        if (sum) {
+            std::rewind(sum.get());
+            previous.emplace(sum.get());
+        }
+        CoefficientReader<T> *previous_ptr = previous ? &*previous : nullptr;
+
+        if (cursor.done()) {
+            detail::multiply_tile(tile, rhs_path, tile_terms, dense_limit, pending_limit, previous_ptr, out);
+        } else {
+            detail::TemporaryFile next = detail::temporary_file();
+            CoefficientWriter<T> writer(next.get(), chunk_terms);
+            detail::multiply_tile(tile, rhs_path, tile_terms, dense_limit, pending_limit, previous_ptr, writer);
+            writer.close();
+            previous.reset();
+            sum = std::move(next);
+        }
+    }
+}
@@ -0,0 +1,377 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "polynomial.h"
+#include "thread_pool.h"
+
+namespace detail {
+
+// Run task(i) for i in [0, count) on up to `threads` threads. Tasks are
+// handed out dynamically so uneven blocks still balance across threads.
+template<typename Task>
+void parallel_for(size_t count, unsigned threads, Task task) {
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next.fetch_add(1)) < count)
+            task(i);
+    };
+
+    std::vector<std::thread> pool;
+    unsigned n_threads = std::min<size_t>(threads, count);
+    for (unsigned t = 1; t < n_threads; ++t)
+        pool.emplace_back(worker);
+    worker();
+    for (auto &thread : pool)
+        thread.join();
+}
+
+// Threads that run many short parallel loops in a row, such as the
+// iterations of a solver, without starting threads per loop. Helper
+// threads are started once and join each loop as it starts. On a pool,
+// every loop instead queues helper tasks that join that loop only and
+// return, so the team never holds a worker between loops and a thread
+// running queued tasks in ThreadPool::parallel_for only helps briefly.
+// The calling thread runs every loop too and never waits for a helper
+// that hasn't joined, so loops complete even if no helper ever runs.
+class WorkerTeam {
+ private:
+    // Shared with the helpers, which may outlive the team while pool
+    // tasks that never joined are still queued
+    struct State {
+        std::mutex mutex;
+        std::condition_variable wake, finished;
+        unsigned long long generation = 0;
+        bool stopping = false;
+        // A loop is in progress
+        bool running = false;
+        // Helpers inside the current loop
+        unsigned active = 0;
+        // Helper tasks queued on the pool and not started yet
+        size_t queued = 0;
+
+        void (*call)(void *, size_t) = nullptr;
+        void *task = nullptr;
+        size_t count = 0;
+        std::atomic<size_t> next{0};
+
+        void work() {
+            size_t i;
+            while ((i = next.fetch_add(1)) < count)
+                call(task, i);
+        }
+
+        // Take part in the current loop from a helper
+        void join(std::unique_lock<std::mutex> &lock) {
+            active++;
+            lock.unlock();
+            work();
+            lock.lock();
+            if (--active == 0)
+                finished.notify_all();
+        }
+    };
+
+    std::shared_ptr<State> state = std::make_shared<State>();
+    std::vector<std::thread> threads;
+    ThreadPool *pool = nullptr;
+
+    static void help(std::shared_ptr<State> state) {
+        unsigned long long seen = 0;
+        std::unique_lock<std::mutex> lock(state->mutex);
+        while (true) {
+            state->wake.wait(lock, [&]() { return state->stopping || state->generation != seen; });
+            if (state->stopping)
+                return;
+            seen = state->generation;
+            state->join(lock);
+        }
+    }
+
+    static void help_once(const std::shared_ptr<State> &state) {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->queued--;
+        if (state->running)
+            state->join(lock);
+    }
+
+ public:
+    // n_threads - 1 helper threads
+    explicit WorkerTeam(unsigned n_threads) {
+        for (unsigned t = 1; t < n_threads; ++t)
+            threads.emplace_back(help, state);
+    }
+
+    // Helpers queued on the workers of a pool for every loop
+    explicit WorkerTeam(ThreadPool &pool) : pool(&pool) {}
+
+    WorkerTeam(WorkerTeam const &) = delete;
+    WorkerTeam &operator= (WorkerTeam const &) = delete;
+
+    ~WorkerTeam() {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->stopping = true;
+        }
+        state->wake.notify_all();
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+    // Call task(i) for every i in [0, count) and wait for all calls to finish
+    template<typename Task>
+    void run(size_t count, Task &task) {
+        size_t new_helpers = 0;
+        {
+            // Late helpers of the previous loop leave before it is replaced
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->finished.wait(lock, [this]() { return state->active == 0; });
+            state->call = [](void *t, size_t i) { (*static_cast<Task *>(t))(i); };
+            state->task = &task;
+            state->count = count;
+            state->next = 0;
+            state->generation++;
+            state->running = true;
+
+            // Helpers still queued from earlier loops join this one
+            size_t helpers = pool && count > 1 ? std::min<size_t>(pool->size(), count - 1) : 0;
+            if (helpers > state->queued) {
+                new_helpers = helpers - state->queued;
+                state->queued = helpers;
+            }
+        }
+        state->wake.notify_all();
+        for (size_t t = 0; t < new_helpers; ++t)
+            pool->submit([state = state]() { help_once(state); });
+        state->work();
+
+        // Helpers that joined may still be finishing their last calls
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [this]() { return state->active == 0; });
+        state->running = false;
+    }
+};
+
+inline unsigned default_thread_count() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+// Terms of a polynomial copied into contiguous arrays for fast scanning
+template<typename T>
+struct TermArrays {
+    std::vector<unsigned> exponents;
+    std::vector<T> coefficients;
+
+    TermArrays() = default;
+
+    explicit TermArrays(const Polynomial<T> &p) {
+        exponents.reserve(p.length());
+        coefficients.reserve(p.length());
+        for (auto &term : p) {
+            exponents.push_back(term.first);
+            coefficients.push_back(term.second);
+        }
+    }
+
+    size_t size() const {
+        return exponents.size();
+    }
+
+    void clear() {
+        exponents.clear();
+        coefficients.clear();
+    }
+};
+
+// Compute the coefficients of lhs*rhs with exponents in [lo, hi).
+// For every output exponent the products are accumulated in ascending order
+// of the lhs exponent, the same order as the serial operator*, so the block
+// results match the serial product exactly.
+template<typename T, typename Emit>
+void multiply_block(const TermArrays<T> &lhs, const TermArrays<T> &rhs,
+                    unsigned long long lo, unsigned long long hi,
+                    bool dense, Emit emit) {
+    std::vector<T> dense_acc;
+    std::map<unsigned long long, T> sparse_acc;
+    if (dense)
+        dense_acc.assign(hi - lo, T());
+
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        unsigned long long e1 = lhs.exponents[i];
+        if (e1 >= hi)
+            break;
+
+        // First rhs term landing inside the block
+        unsigned long long min_e2 = lo > e1 ? lo - e1 : 0;
+        auto first = std::lower_bound(rhs.exponents.begin(), rhs.exponents.end(), min_e2);
+
+        for (size_t j = first - rhs.exponents.begin(); j < rhs.size(); ++j) {
+            unsigned long long k = e1 + rhs.exponents[j];
+            if (k >= hi)
+                break;
+            T product = lhs.coefficients[i] * rhs.coefficients[j];
+            if (dense)
+                dense_acc[k - lo] += product;
+            else
+                sparse_acc[k] += product;
+        }
+    }
+
+    if (dense) {
+        for (size_t k = 0; k < dense_acc.size(); ++k)
+            if (dense_acc[k] != T())
+                emit(unsigned(lo + k), dense_acc[k]);
+    } else {
+        for (auto &term : sparse_acc)
+            if (term.second != T())
+                emit(unsigned(term.first), term.second);
+    }
+}
+
+template<typename T, typename Run>
+Polynomial<T> multiply_blocks(const Polynomial<T> &lhs, const Polynomial<T> &rhs,
+                              unsigned threads, Run run) {
+    TermArrays<T> a(lhs), b(rhs);
+    unsigned long long lo = (unsigned long long)a.exponents.front() + b.exponents.front();
+    unsigned long long hi = (unsigned long long)a.exponents.back() + b.exponents.back() + 1;
+    unsigned long long span = hi - lo;
+
+    // Accumulate into dense blocks unless the output exponent range is much
+    // larger than the number of products it can receive
+    unsigned long long products = (unsigned long long)a.size() * b.size();
+    bool dense = span <= 4 * products;
+
+    // Several blocks per thread so that blocks with more overlapping
+    // terms don't leave the other threads idle
+    size_t n_blocks = std::min<unsigned long long>(span, 4ull * threads);
+    unsigned long long width = (span + n_blocks - 1) / n_blocks;
+    n_blocks = (span + width - 1) / width;
+
+    std::vector<std::vector<std::pair<unsigned, T>>> blocks(n_blocks);
+    run(n_blocks, [&](size_t block) {
+        unsigned long long block_lo = lo + block * width;
+        unsigned long long block_hi = std::min(hi, block_lo + width);
+        auto &out = blocks[block];
+        multiply_block(a, b, block_lo, block_hi, dense, [&](unsigned e, const T &c) {
+            out.emplace_back(e, c);
+        });
+    });
+
+    // Blocks cover disjoint ascending exponent ranges, so the result is
+    // built by appending
+    Polynomial<T> result;
+    for (auto &block : blocks)
+        for (auto &term : block)
+            result.add_term(term.first, term.second);
+    return result;
+}
+
+} // namespace detail
+
+// Multiply two polynomials using up to `threads` threads. The output
+// exponent range is split into independent blocks, and each output
+// coefficient is accumulated in the same order as in operator*, so the
+// result is identical to the serial product.
+template<typename T>
+Polynomial<T> multiply(const Polynomial<T> &lhs, const Polynomial<T> &rhs,
+                       unsigned threads = detail::default_thread_count()) {
+    // Not worth starting threads for small products
+    const size_t min_parallel_products = 1 << 14;
+    if (threads <= 1 || lhs.length() == 0 || rhs.length() == 0 ||
+        lhs.length() * rhs.length() < min_parallel_products)
+        return lhs * rhs;
+
+    return detail::multiply_blocks(lhs, rhs, threads, [threads](size_t n, auto task) {
+        detail::parallel_for(n, threads, task);
+    });
+}
+
+// Multiply two polynomials on the workers of a thread pool
+template<typename T>
+Polynomial<T> multiply(const Polynomial<T> &lhs, const Polynomial<T> &rhs, ThreadPool &pool) {
+    const size_t min_parallel_products = 1 << 14;
+    if (pool.size() <= 1 || lhs.length() == 0 || rhs.length() == 0 ||
+        lhs.length() * rhs.length() < min_parallel_products)
+        return lhs * rhs;
+
+    return detail::multiply_blocks(lhs, rhs, pool.size(), [&pool](size_t n, auto task) {
+        pool.parallel_for(n, task, 1);
+    });
+}
+
+namespace detail {
+
+// results[i] = make(i) computed on the pool. Each result is constructed
+// under the memory resource of the worker that computes it, so workers
+// share no allocator, and then copied into the caller's resource on the
+// calling thread, which needn't be thread safe.
+template<typename T, typename Make>
+std::vector<Polynomial<T>> batch_results(size_t count, ThreadPool &pool, Make make) {
+    typename Polynomial<T>::allocator_type allocator(polynomial_memory_resource());
+    std::vector<std::optional<Polynomial<T>>> slots(count);
+    pool.parallel_for(count, [&](size_t i) {
+        PolynomialResourceScope scope(pool.worker_resource());
+        slots[i].emplace(make(i));
+    });
+
+    std::vector<Polynomial<T>> result;
+    result.reserve(count);
+    for (auto &slot : slots) {
+        result.emplace_back(*slot, allocator);
+        slot.reset();
+    }
+    return result;
+}
+
+} // namespace detail
+
+// Batch operations on many independent polynomials. Each result is written
+// to its own slot, so workers share no state besides the pool's task
+// queues. Polynomial results allocate from the memory resource of the
+// calling thread, like the results of the serial operations.
+
+// Pairwise products lhs[i] * rhs[i]
+template<typename T>
+std::vector<Polynomial<T>> multiply_batch(const std::vector<Polynomial<T>> &lhs,
+                                          const std::vector<Polynomial<T>> &rhs,
+                                          ThreadPool &pool) {
+    if (lhs.size() != rhs.size())
+        throw std::invalid_argument("multiply_batch: operand counts differ");
+
+    return detail::batch_results<T>(lhs.size(), pool, [&](size_t i) {
+        return lhs[i] * rhs[i];
+    });
+}
+
+// Values polynomials[i](points[i])
+template<typename T, typename U>
+std::vector<U> evaluate_batch(const std::vector<Polynomial<T>> &polynomials,
+                              const std::vector<U> &points,
+                              ThreadPool &pool) {
+    if (polynomials.size() != points.size())
+        throw std::invalid_argument("evaluate_batch: polynomial and point counts differ");
+
+    std::vector<U> result(polynomials.size());
+    pool.parallel_for(polynomials.size(), [&](size_t i) {
+        result[i] = polynomials[i](points[i]);
+    });
+    return result;
+}
+
+// Derivatives of all polynomials
+template<typename T>
+std::vector<Polynomial<T>> differentiate_batch(const std::vector<Polynomial<T>> &polynomials,
+                                               ThreadPool &pool) {
+    return detail::batch_results<T>(polynomials.size(), pool, [&](size_t i) {
+        return polynomials[i].differentiate();
+    });
+}
@@ -0,0 +1,220 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "polynomial.h"
+
+// Piecewise polynomials such as splines, built from Polynomial segments
+// and laid out for fast evaluation at many points.
+//
+// Segment i covers [breakpoints[i], breakpoints[i + 1]) and is stored in
+// the local variable x - breakpoints[i]. Coefficients are kept as a
+// structure of arrays, one row per power holding that coefficient of every
+// segment, padded to the highest degree, so each step of Horner's rule
+// over a block of points reads a single row. The segment of a point is
+// found with a branch-free search of the interior breakpoints in
+// Eytzinger (breadth-first) order, which keeps the top levels of the
+// search tree together in cache, or by walking forward for sorted points.
+
+enum class PieceVariable {
+    // Segment i is a polynomial in x - breakpoints[i]
+    local,
+    // Segments are polynomials in x
+    global
+};
+
+template<typename T>
+class PiecewisePolynomial {
+ private:
+    std::vector<T> breakpoints;
+    size_t order = 0;
+    // coefficients[k * segments() + i] is the coefficient of power k of segment i
+    std::vector<T> coefficients;
+    // Interior breakpoints in Eytzinger order from index 1, and their
+    // indices in ascending order
+    std::vector<T> tree;
+    std::vector<size_t> ranks;
+
+    size_t build_tree(size_t i, size_t k) {
+        if (k < tree.size()) {
+            i = build_tree(i, 2 * k);
+            tree[k] = breakpoints[i + 1];
+            ranks[k] = i++;
+            i = build_tree(i, 2 * k + 1);
+        }
+        return i;
+    }
+
+    // Polynomial q with q(y) = p(y + a)
+    static Polynomial<T> shift(const Polynomial<T> &p, T a) {
+        Polynomial<T> y_plus_a(std::map<unsigned, T>({{0, a}, {1, T(1)}})), result;
+        if (p.length() == 0)
+            return result;
+        for (unsigned k = p.degree() + 1; k-- > 0; ) {
+            result *= y_plus_a;
+            result.add_term(0, p.coefficient(k));
+        }
+        return result;
+    }
+
+ public:
+    PiecewisePolynomial() = default;
+
+    // Segments between consecutive breakpoints, which must be strictly
+    // increasing, with one more breakpoint than pieces
+    PiecewisePolynomial(std::vector<T> breakpoints, const std::vector<Polynomial<T>> &pieces,
+                        PieceVariable variable = PieceVariable::local)
+        : breakpoints(std::move(breakpoints)) {
+        const std::vector<T> &x = this->breakpoints;
+        if (pieces.empty() || x.size() != pieces.size() + 1)
+            throw std::invalid_argument("PiecewisePolynomial: need one more breakpoint than pieces");
+        for (size_t i = 1; i < x.size(); ++i)
+            if (!(x[i - 1] < x[i]))
+                throw std::invalid_argument("PiecewisePolynomial: breakpoints must be increasing");
+
+        std::vector<Polynomial<T>> local;
+        if (variable == PieceVariable::global) {
+            for (size_t i = 0; i < pieces.size(); ++i)
+                local.push_back(shift(pieces[i], x[i]));
+        }
+        const std::vector<Polynomial<T>> &polynomials = variable == PieceVariable::global ? local : pieces;
+
+        order = 1;
+        for (auto &p : polynomials)
+            order = std::max<size_t>(order, size_t(p.degree()) + 1);
+        size_t n = polynomials.size();
+        coefficients.assign(order * n, T());
+        for (size_t i = 0; i < n; ++i)
+            for (auto &term : polynomials[i])
+                coefficients[term.first * n + i] = term.second;
+
+        tree.resize(n);
+        ranks.resize(n);
+        build_tree(0, 1);
+    }
+
+    size_t segments() const {
+        return breakpoints.empty() ? 0 : breakpoints.size() - 1;
+    }
+
+    const std::vector<T> &knots() const {
+        return breakpoints;
+    }
+
+    // Segment i in the local variable x - breakpoints[i]
+    Polynomial<T> segment(size_t i) const {
+        Polynomial<T> result;
+        for (size_t k = 0; k < order; ++k)
+            result.add_term(unsigned(k), coefficients[k * segments() + i]);
+        return result;
+    }
+
+    // Index of the segment containing x. Points beyond the first or last
+    // breakpoint belong to the first or last segment.
+    size_t find_segment(T x) const {
+        // Descend to the left on x < tree[k] and to the right otherwise,
+        // then drop the trailing right turns and the last left turn to
+        // get the first interior breakpoint above x
+        size_t k = 1, n = tree.size();
+        while (k < n)
+            k = 2 * k + (tree[k] <= x);
+        while (k & 1)
+            k >>= 1;
+        k >>= 1;
+        return k == 0 ? n - 1 : ranks[k];
+    }
+
+    PiecewisePolynomial differentiate() const {
+        PiecewisePolynomial result(*this);
+        size_t n = segments();
+        if (order > 1) {
+            result.order = order - 1;
+            result.coefficients.assign(result.order * n, T());
+            for (size_t k = 1; k < order; ++k)
+                for (size_t i = 0; i < n; ++i)
+                    result.coefficients[(k - 1) * n + i] = coefficients[k * n + i] * T(k);
+        } else {
+            std::fill(result.coefficients.begin(), result.coefficients.end(), T());
+        }
+        return result;
+    }
+
+    // evaluate at a point, extrapolating the end segments outside the
+    // breakpoints
+    template<typename U>
+    U operator() (U x) const {
+        if (breakpoints.empty())
+            return U();
+        size_t i = find_segment(x), n = segments();
+        U dx = x - breakpoints[i], result = U(coefficients[(order - 1) * n + i]);
+        for (size_t k = order - 1; k-- > 0; )
+            result = result * dx + coefficients[k * n + i];
+        return result;
+    }
+
+    // evaluate at count points in any order
+    template<typename U>
+    void evaluate(const U *points, size_t count, U *values) const {
+        evaluate_blocks(points, count, values, [this](const U *x, size_t n, size_t *segment) {
+            for (size_t i = 0; i < n; ++i)
+                segment[i] = find_segment(x[i]);
+        });
+    }
+
+    // evaluate at count points in ascending order, finding the segments
+    // by walking forward a few breakpoints before falling back to the
+    // search. Points out of order are still evaluated correctly.
+    template<typename U>
+    void evaluate_sorted(const U *points, size_t count, U *values) const {
+        size_t current = 0;
+        evaluate_blocks(points, count, values, [this, &current](const U *x, size_t n, size_t *segment) {
+            size_t last = segments() - 1;
+            for (size_t i = 0; i < n; ++i) {
+                if (current > 0 && x[i] < breakpoints[current])
+                    current = find_segment(x[i]);
+                for (size_t steps = 0; current < last && breakpoints[current + 1] <= x[i]; ++current) {
+                    if (++steps == 8) {
+                        current = find_segment(x[i]);
+                        break;
+                    }
+                }
+                segment[i] = current;
+            }
+        });
+    }
+
+ private:
+    // Find the segments of a block of points with locate(x, n, segment),
+    // then run Horner's rule over the block, one coefficient row at a time
+    template<typename U, typename Locate>
+    void evaluate_blocks(const U *points, size_t count, U *values, Locate locate) const {
+        if (breakpoints.empty()) {
+            std::fill(values, values + count, U());
+            return;
+        }
+
+        const size_t block = 64;
+        size_t segment[block];
+        U dx[block];
+        size_t n_segments = segments();
+        for (size_t offset = 0; offset < count; offset += block) {
+            size_t n = std::min(block, count - offset);
+            const U *x = points + offset;
+            U *result = values + offset;
+            locate(x, n, segment);
+            const T *row = &coefficients[(order - 1) * n_segments];
+            for (size_t i = 0; i < n; ++i) {
+                dx[i] = x[i] - breakpoints[segment[i]];
+                result[i] = U(row[segment[i]]);
+            }
+            for (size_t k = order - 1; k-- > 0; ) {
+                row = &coefficients[k * n_segments];
+                for (size_t i = 0; i < n; ++i)
+                    result[i] = result[i] * dx[i] + row[segment[i]];
+            }
+        }
+    }
+};
@@ -0,0 +1,327 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "polynomial.h"
+#include "polynomial_chebyshev.h"
+#include "static_polynomial.h"
+
+// Minimax polynomial approximation of functions with the Remez exchange
+// algorithm.
+//
+// The interval is mapped to [-1, 1] and the approximant is computed in
+// the Chebyshev basis there, which keeps the linear systems well
+// conditioned for high degrees. Each iteration solves for the polynomial
+// whose error levels out with alternating signs on the n + 2 reference
+// points, then moves the reference to the extrema of the new error,
+// located on a grid clustered towards the ends of the interval and
+// refined by golden section search. The result is converted to a
+// monomial Polynomial in the original variable, ready for Horner's or
+// Estrin's scheme, or a StaticPolynomial.
+
+struct RemezOptions {
+    // Minimize the relative error |f - p| / |f| instead of the absolute
+    // error. f must not vanish on the interval.
+    bool relative = false;
+    unsigned max_iterations = 50;
+    // Stop when the largest error exceeds the levelled error by less
+    // than this fraction, or by no more than rounding noise
+    double tolerance = 1e-6;
+    // Points of the grid searched for extrema, 0 for 32 per reference point
+    size_t grid_points = 0;
+};
+
+template<typename T>
+struct MinimaxApproximation {
+    // Approximant in x
+    Polynomial<T> polynomial;
+    // The same in the Chebyshev basis of t = (2x - lower - upper) / (upper - lower)
+    ChebyshevPolynomial<T> chebyshev;
+    T lower;
+    T upper;
+    // Largest error of polynomial measured on the grid and reference,
+    // absolute or relative according to the options
+    T max_error;
+    // Error of the last reference system, a lower bound of the minimax error
+    T levelled_error;
+    // Points where the error alternates in sign
+    std::vector<T> reference;
+    unsigned iterations;
+    bool converged;
+
+    // The approximant as a StaticPolynomial with N >= degree + 1 coefficients
+    template<size_t N>
+    StaticPolynomial<T, N> static_polynomial() const {
+        return StaticPolynomial<T, N>(polynomial);
+    }
+};
+
+namespace detail {
+
+template<typename T>
+struct CTypeName;
+
+template<>
+struct CTypeName<float> {
+    static constexpr const char *name = "float";
+    static constexpr const char *suffix = "f";
+};
+
+template<>
+struct CTypeName<double> {
+    static constexpr const char *name = "double";
+    static constexpr const char *suffix = "";
+};
+
+template<>
+struct CTypeName<long double> {
+    static constexpr const char *name = "long double";
+    static constexpr const char *suffix = "L";
+};
+
+// Solve the square system a x = b in place with partial pivoting
+template<typename T>
+void solve_linear(std::vector<std::vector<T>> &a, std::vector<T> &b) {
+    size_t n = b.size();
+    for (size_t column = 0; column < n; ++column) {
+        size_t pivot = column;
+        for (size_t row = column + 1; row < n; ++row)
+            if (std::fabs(a[row][column]) > std::fabs(a[pivot][column]))
+                pivot = row;
+        if (a[pivot][column] == T())
+            throw std::runtime_error("remez: singular reference system");
+        std::swap(a[column], a[pivot]);
+        std::swap(b[column], b[pivot]);
+
+        for (size_t row = column + 1; row < n; ++row) {
+            T factor = a[row][column] / a[column][column];
+            for (size_t k = column; k < n; ++k)
+                a[row][k] -= factor * a[column][k];
+            b[row] -= factor * b[column];
+        }
+    }
+    for (size_t row = n; row-- > 0; ) {
+        for (size_t k = row + 1; k < n; ++k)
+            b[row] -= a[row][k] * b[k];
+        b[row] /= a[row][row];
+    }
+}
+
+// Keep n of the alternating extrema, dropping the smallest ones while
+// preserving the alternation: an end point alone, or an interior point
+// together with its smaller neighbour
+template<typename T>
+void reduce_alternation(std::vector<T> &points, std::vector<T> &errors, size_t n) {
+    while (points.size() > n) {
+        size_t smallest = 0;
+        for (size_t i = 1; i < points.size(); ++i)
+            if (std::fabs(errors[i]) < std::fabs(errors[smallest]))
+                smallest = i;
+
+        size_t first, count;
+        if (smallest == 0 || smallest == points.size() - 1) {
+            first = smallest;
+            count = 1;
+        } else if (points.size() - n == 1) {
+            first = std::fabs(errors.front()) < std::fabs(errors.back()) ? 0 : points.size() - 1;
+            count = 1;
+        } else {
+            first = std::fabs(errors[smallest - 1]) < std::fabs(errors[smallest + 1]) ? smallest - 1 : smallest;
+            count = 2;
+        }
+        points.erase(points.begin() + first, points.begin() + first + count);
+        errors.erase(errors.begin() + first, errors.begin() + first + count);
+    }
+}
+
+} // namespace detail
+
+// Minimax approximation of f by a polynomial of the given degree on
+// [lower, upper]. Throws std::invalid_argument for an empty interval and
+// std::runtime_error if a reference system is singular. If the iterations
+// run out before the error levels out, the last approximant is returned
+// with converged set to false.
+template<typename T, typename F>
+MinimaxApproximation<T> remez(F f, unsigned degree, T lower, T upper,
+                              const RemezOptions &options = RemezOptions()) {
+    static_assert(std::is_floating_point<T>::value, "remez needs a floating point type");
+    if (!(lower < upper))
+        throw std::invalid_argument("remez: interval is empty");
+
+    const T pi = std::acos(T(-1));
+    const size_t n = size_t(degree) + 2;
+    T half_width = (upper - lower) / 2, center = lower + half_width;
+    auto to_x = [&](T t) {
+        return std::min(upper, std::max(lower, center + half_width * t));
+    };
+    auto weight = [&](T fx) {
+        return options.relative ? std::fabs(fx) : T(1);
+    };
+
+    ChebyshevPolynomial<T> q;
+    auto error = [&](T t) {
+        T fx = T(f(to_x(t)));
+        return (fx - q(t)) / weight(fx);
+    };
+
+    // Start from the extrema of T_{n-1}, the reference of the minimax
+    // approximation of x^(n-1)
+    std::vector<T> reference(n);
+    for (size_t i = 0; i < n; ++i)
+        reference[i] = -std::cos(pi * T(i) / T(n - 1));
+
+    size_t grid_size = options.grid_points ? std::max(options.grid_points, n) : 32 * n;
+    std::vector<T> grid(grid_size);
+    for (size_t j = 0; j < grid_size; ++j)
+        grid[j] = -std::cos(pi * T(j) / T(grid_size - 1));
+
+    MinimaxApproximation<T> result;
+    result.lower = lower;
+    result.upper = upper;
+    result.converged = false;
+    result.iterations = 0;
+    result.levelled_error = 0;
+
+    // Errors below this are rounding noise
+    std::vector<T> f_grid(grid_size), values(grid_size), points, errors;
+    T noise = 0;
+    for (size_t j = 0; j < grid_size; ++j) {
+        f_grid[j] = T(f(to_x(grid[j])));
+        noise = std::max(noise, std::fabs(f_grid[j]) / weight(f_grid[j]));
+    }
+    noise *= 64 * std::numeric_limits<T>::epsilon();
+
+    while (result.iterations < options.max_iterations) {
+        ++result.iterations;
+
+        // sum c_k T_k(t_i) + (-1)^i E w_i = f(x_i)
+        std::vector<std::vector<T>> a(n, std::vector<T>(n));
+        std::vector<T> b(n);
+        for (size_t i = 0; i < n; ++i) {
+            T t = reference[i], fx = T(f(to_x(t)));
+            a[i][0] = 1;
+            if (n > 2)
+                a[i][1] = t;
+            for (size_t k = 2; k + 1 < n; ++k)
+                a[i][k] = 2 * t * a[i][k - 1] - a[i][k - 2];
+            a[i][n - 1] = (i % 2 ? -1 : 1) * weight(fx);
+            b[i] = fx;
+        }
+        detail::solve_linear(a, b);
+        result.levelled_error = std::fabs(b[n - 1]);
+        b.pop_back();
+        q = ChebyshevPolynomial<T>(std::move(b));
+
+        // One extremum per run of equal signs of the error on the grid,
+        // refined by golden section search between its grid neighbours
+        for (size_t j = 0; j < grid_size; ++j)
+            values[j] = (f_grid[j] - q(grid[j])) / weight(f_grid[j]);
+        points.clear();
+        errors.clear();
+        T largest = 0;
+        for (size_t j = 0; j < grid_size; ) {
+            if (values[j] == T()) {
+                ++j;
+                continue;
+            }
+            bool positive = values[j] > 0;
+            size_t best = j;
+            for (; j < grid_size && values[j] != T() && (values[j] > 0) == positive; ++j)
+                if (std::fabs(values[j]) > std::fabs(values[best]))
+                    best = j;
+
+            T sign = positive ? 1 : -1;
+            T left = grid[best > 0 ? best - 1 : 0], right = grid[best + 1 < grid_size ? best + 1 : best];
+            T point = grid[best], value = values[best];
+            const T ratio = (std::sqrt(T(5)) - 1) / 2;
+            T x1 = right - ratio * (right - left), x2 = left + ratio * (right - left);
+            T e1 = sign * error(x1), e2 = sign * error(x2);
+            for (int step = 0; step < 40 && right - left > 4 * std::numeric_limits<T>::epsilon(); ++step) {
+                if (e1 > e2) {
+                    right = x2;
+                    x2 = x1;
+                    e2 = e1;
+                    x1 = right - ratio * (right - left);
+                    e1 = sign * error(x1);
+                } else {
+                    left = x1;
+                    x1 = x2;
+                    e1 = e2;
+                    x2 = left + ratio * (right - left);
+                    e2 = sign * error(x2);
+                }
+            }
+            if (std::max(e1, e2) > sign * value) {
+                point = e1 > e2 ? x1 : x2;
+                value = sign * std::max(e1, e2);
+            }
+            points.push_back(point);
+            errors.push_back(value);
+            largest = std::max(largest, std::fabs(value));
+        }
+
+        // Matched to rounding, or too few sign changes to exchange
+        if (largest <= noise || points.size() < n) {
+            result.converged = largest <= noise;
+            break;
+        }
+        detail::reduce_alternation(points, errors, n);
+        reference = points;
+        if (largest - result.levelled_error <= T(options.tolerance) * largest + noise) {
+            result.converged = true;
+            break;
+        }
+    }
+
+    result.polynomial = q.to_polynomial(lower, upper);
+    result.chebyshev = q;
+
+    // Measure the error of the monomial form actually returned
+    result.max_error = 0;
+    auto measure = [&](T t) {
+        T x = to_x(t), fx = T(f(x));
+        result.max_error = std::max(result.max_error, std::fabs(fx - result.polynomial(x)) / weight(fx));
+    };
+    for (T t : grid)
+        measure(t);
+    for (T t : reference)
+        measure(t);
+
+    result.reference.clear();
+    for (T t : reference)
+        result.reference.push_back(to_x(t));
+    return result;
+}
+
+// C++ source for an array of the coefficients of p in ascending order of
+// exponent, written to round-trip exactly, e.g.
+// static const double name[3] = {1.0, 0.5, 0.125};
+// Throws std::invalid_argument for infinite or NaN coefficients.
+template<typename T>
+std::string coefficient_table(const Polynomial<T> &p, const std::string &name) {
+    static_assert(std::is_floating_point<T>::value, "coefficient_table needs floating point coefficients");
+    unsigned length = p.length() == 0 ? 1 : p.degree() + 1;
+    std::string out = std::string("static const ") + detail::CTypeName<T>::name + " " + name +
+                      "[" + std::to_string(length) + "] = {";
+    char buffer[64];
+    for (unsigned k = 0; k < length; ++k) {
+        if (!std::isfinite(p.coefficient(k)))
+            throw std::invalid_argument("coefficient_table: coefficient is not finite");
+        auto written = std::to_chars(buffer, buffer + sizeof(buffer), p.coefficient(k));
+        if (k > 0)
+            out += ", ";
+        std::string number(buffer, written.ptr);
+        if (number.find_first_of(".e") == std::string::npos)
+            number += ".0";
+        out += number + detail::CTypeName<T>::suffix;
+    }
+    out += "};\n";
+    return out;
+}
@@ -0,0 +1,941 @@
+#pragma once
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "polynomial.h"
+#include "polynomial_parallel.h"
+
+// Real root isolation with the Vincent-Collins-Akritas method.
+//
+// Positive roots are scaled into (0, 1) with a power of two bound. By
+// Descartes' rule of signs the number of roots of q in (0, 1) is at most
+// the number of sign variations of (x + 1)^n q(1 / (x + 1)), and exactly
+// one if that number is 1. Intervals with more variations are halved with
+// Taylor shifts until every root is isolated. Intervals that can't be
+// resolved this way within a fixed depth, which happens for multiple
+// roots, are isolated by counting distinct roots with a Sturm sequence.
+// Negative roots are the positive roots of p(-x).
+//
+// Integer coefficients are handled exactly with arbitrary precision
+// integers, so all roots are found and none are reported twice. Floating
+// point coefficients are handled in long double.
+
+namespace detail {
+
+// Arbitrary precision integer with the operations needed by the root
+// isolation: addition, multiplication and shifts
+class BigInt {
+ private:
+    // Magnitude, least significant limb first, no leading zero limbs
+    std::vector<uint32_t> limbs;
+    bool negative = false;
+
+    void trim() {
+        while (!limbs.empty() && limbs.back() == 0)
+            limbs.pop_back();
+        if (limbs.empty())
+            negative = false;
+    }
+
+    static int compare_magnitude(const std::vector<uint32_t> &a, const std::vector<uint32_t> &b) {
+        if (a.size() != b.size())
+            return a.size() < b.size() ? -1 : 1;
+        for (size_t i = a.size(); i-- > 0;)
+            if (a[i] != b[i])
+                return a[i] < b[i] ? -1 : 1;
+        return 0;
+    }
+
+    // a += b
+    static void add_magnitude(std::vector<uint32_t> &a, const std::vector<uint32_t> &b) {
+        if (a.size() < b.size())
+            a.resize(b.size(), 0);
+        uint64_t carry = 0;
+        for (size_t i = 0; i < a.size() && (carry || i < b.size()); ++i) {
+            uint64_t sum = uint64_t(a[i]) + (i < b.size() ? b[i] : 0) + carry;
+            a[i] = uint32_t(sum);
+            carry = sum >> 32;
+        }
+        if (carry)
+            a.push_back(uint32_t(carry));
+    }
+
+    // a -= b, where |a| >= |b|
+    static void subtract_magnitude(std::vector<uint32_t> &a, const std::vector<uint32_t> &b) {
+        uint64_t borrow = 0;
+        for (size_t i = 0; i < a.size() && (borrow || i < b.size()); ++i) {
+            uint64_t subtrahend = (i < b.size() ? b[i] : 0) + borrow;
+            borrow = a[i] < subtrahend;
+            a[i] = uint32_t(a[i] - subtrahend);
+        }
+    }
+
+    void add(const BigInt &rhs, bool rhs_negative) {
+        if (negative == rhs_negative) {
+            add_magnitude(limbs, rhs.limbs);
+        } else if (compare_magnitude(limbs, rhs.limbs) >= 0) {
+            subtract_magnitude(limbs, rhs.limbs);
+        } else {
+            std::vector<uint32_t> magnitude = rhs.limbs;
+            subtract_magnitude(magnitude, limbs);
+            limbs.swap(magnitude);
+            negative = rhs_negative;
+        }
+        trim();
+    }
+
+ public:
+    BigInt() = default;
+
+    template<typename I, typename = std::enable_if_t<std::is_integral<I>::value>>
+    BigInt(I value) : negative(value < 0) {
+        unsigned long long magnitude = value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value;
+        for (; magnitude; magnitude >>= 32)
+            limbs.push_back(uint32_t(magnitude));
+    }
+
+    int sign() const {
+        return limbs.empty() ? 0 : negative ? -1 : 1;
+    }
+
+    // Number of bits of the magnitude
+    unsigned bit_length() const {
+        if (limbs.empty())
+            return 0;
+        unsigned bits = 0;
+        for (uint32_t top = limbs.back(); top; top >>= 1)
+            ++bits;
+        return 32 * unsigned(limbs.size() - 1) + bits;
+    }
+
+    // Number of trailing zero bits of the magnitude, 0 for zero
+    unsigned trailing_zeros() const {
+        for (size_t i = 0; i < limbs.size(); ++i) {
+            if (limbs[i]) {
+                unsigned bits = 0;
+                for (uint32_t limb = limbs[i]; !(limb & 1); limb >>= 1)
+                    ++bits;
+                return 32 * unsigned(i) + bits;
+            }
+        }
+        return 0;
+    }
+
+    long double to_long_double() const {
+        long double value = 0;
+        for (size_t i = limbs.size(); i-- > 0;)
+            value = value * 4294967296.0L + limbs[i];
+        return negative ? -value : value;
+    }
+
+    BigInt operator- () const {
+        BigInt result = *this;
+        if (!result.limbs.empty())
+            result.negative = !negative;
+        return result;
+    }
+
+    BigInt &operator+= (const BigInt &rhs) {
+        add(rhs, rhs.negative);
+        return *this;
+    }
+
+    BigInt &operator-= (const BigInt &rhs) {
+        add(rhs, !rhs.negative && !rhs.limbs.empty());
+        return *this;
+    }
+
+    BigInt &operator<<= (unsigned bits) {
+        if (limbs.empty())
+            return *this;
+        unsigned shift = bits % 32;
+        if (shift) {
+            uint32_t carry = 0;
+            for (auto &limb : limbs) {
+                uint32_t next = limb >> (32 - shift);
+                limb = (limb << shift) | carry;
+                carry = next;
+            }
+            if (carry)
+                limbs.push_back(carry);
+        }
+        limbs.insert(limbs.begin(), bits / 32, 0);
+        return *this;
+    }
+
+    // Shift the magnitude right, discarding the low bits
+    BigInt &operator>>= (unsigned bits) {
+        size_t words = bits / 32;
+        if (words >= limbs.size()) {
+            limbs.clear();
+            negative = false;
+            return *this;
+        }
+        limbs.erase(limbs.begin(), limbs.begin() + words);
+        unsigned shift = bits % 32;
+        if (shift) {
+            for (size_t i = 0; i < limbs.size(); ++i) {
+                uint32_t high = i + 1 < limbs.size() ? limbs[i + 1] << (32 - shift) : 0;
+                limbs[i] = (limbs[i] >> shift) | high;
+            }
+        }
+        trim();
+        return *this;
+    }
+
+    friend BigInt operator+ (BigInt lhs, const BigInt &rhs) {
+        return lhs += rhs;
+    }
+
+    friend BigInt operator- (BigInt lhs, const BigInt &rhs) {
+        return lhs -= rhs;
+    }
+
+    friend BigInt operator* (const BigInt &lhs, const BigInt &rhs) {
+        BigInt result;
+        if (lhs.limbs.empty() || rhs.limbs.empty())
+            return result;
+        result.limbs.assign(lhs.limbs.size() + rhs.limbs.size(), 0);
+        for (size_t i = 0; i < lhs.limbs.size(); ++i) {
+            uint64_t carry = 0;
+            for (size_t j = 0; j < rhs.limbs.size(); ++j) {
+                uint64_t current = result.limbs[i + j] + uint64_t(lhs.limbs[i]) * rhs.limbs[j] + carry;
+                result.limbs[i + j] = uint32_t(current);
+                carry = current >> 32;
+            }
+            result.limbs[i + rhs.limbs.size()] = uint32_t(carry);
+        }
+        result.negative = lhs.negative != rhs.negative;
+        result.trim();
+        return result;
+    }
+};
+
+// Operations on the two scalar types of the root isolation: BigInt for
+// exact computations and long double otherwise
+
+inline int scalar_sign(const BigInt &x) {
+    return x.sign();
+}
+
+inline int scalar_sign(long double x) {
+    return (x > 0) - (x < 0);
+}
+
+inline void multiply_pow2(BigInt &x, unsigned e) {
+    x <<= e;
+}
+
+inline void multiply_pow2(long double &x, unsigned e) {
+    x = std::ldexp(x, int(e));
+}
+
+// Smallest b with |x| < 2^b, for nonzero x
+inline int bit_length(const BigInt &x) {
+    return int(x.bit_length());
+}
+
+inline int bit_length(long double x) {
+    return std::ilogb(x) + 1;
+}
+
+inline long double to_long_double(const BigInt &x) {
+    return x.to_long_double();
+}
+
+inline long double to_long_double(long double x) {
+    return x;
+}
+
+// Divide out common powers of two, which doesn't change any signs
+inline void normalize(std::vector<BigInt> &q) {
+    unsigned shift = std::numeric_limits<unsigned>::max();
+    for (auto &c : q)
+        if (c.sign() != 0)
+            shift = std::min(shift, c.trailing_zeros());
+    if (shift != std::numeric_limits<unsigned>::max() && shift > 0)
+        for (auto &c : q)
+            c >>= shift;
+}
+
+inline void normalize(std::vector<long double> &q) {
+    long double largest = 0;
+    for (auto c : q)
+        largest = std::max(largest, std::fabs(c));
+    if (largest > 0) {
+        int e = std::ilogb(largest);
+        for (auto &c : q)
+            c = std::ldexp(c, -e);
+    }
+}
+
+// q(x) -> q(2^b x), with common powers of two divided out
+inline void scale_variable(std::vector<BigInt> &q, unsigned b) {
+    for (size_t i = 1; i < q.size(); ++i)
+        q[i] <<= unsigned(b * i);
+    normalize(q);
+}
+
+// The same in long double. The powers 2^(b i) are applied relative to the
+// largest scaled coefficient, which keeps it near 1 where 2^(b i) alone
+// would overflow.
+inline void scale_variable(std::vector<long double> &q, unsigned b) {
+    long long top = std::numeric_limits<long long>::min();
+    for (size_t i = 0; i < q.size(); ++i)
+        if (q[i] != 0)
+            top = std::max(top, std::ilogb(q[i]) + (long long)b * (long long)i);
+    for (size_t i = 0; i < q.size(); ++i)
+        if (q[i] != 0)
+            q[i] = std::ldexp(q[i], int(std::max<long long>((long long)b * (long long)i - top, INT_MIN / 2)));
+}
+
+// Sign of q(a / 2^j), computed exactly as the sign of 2^(j n) q(a / 2^j)
+inline int sign_at(const std::vector<BigInt> &q, const BigInt &a, unsigned j) {
+    size_t n = q.size() - 1;
+    BigInt value = q[n];
+    for (size_t i = n; i-- > 0;) {
+        BigInt term = q[i];
+        term <<= unsigned(j * (n - i));
+        value = value * a + term;
+    }
+    return value.sign();
+}
+
+inline int sign_at(const std::vector<long double> &q, long double a, unsigned j) {
+    long double t = std::ldexp(a, -int(j)), value = 0;
+    for (size_t i = q.size(); i-- > 0;)
+        value = value * t + q[i];
+    return scalar_sign(value);
+}
+
+template<typename Scalar>
+int sign_variations(const std::vector<Scalar> &q) {
+    int variations = 0, last = 0;
+    for (auto &c : q) {
+        int s = scalar_sign(c);
+        if (s != 0) {
+            variations += last != 0 && s != last;
+            last = s;
+        }
+    }
+    return variations;
+}
+
+// q(x) -> q(x + 1) with n^2 / 2 additions
+template<typename Scalar>
+void taylor_shift(std::vector<Scalar> &q) {
+    size_t n = q.size() - 1;
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = n - 1; j + 1 > i; --j)
+            q[j] += q[j + 1];
+}
+
+// Sign variations of (x + 1)^n q(1 / (x + 1)), a bound on the number of
+// roots of q in (0, 1)
+template<typename Scalar>
+int descartes_bound(const std::vector<Scalar> &q) {
+    std::vector<Scalar> transformed(q.rbegin(), q.rend());
+    taylor_shift(transformed);
+    return sign_variations(transformed);
+}
+
+// q(x) -> 2^n q(x / 2), mapping (0, 1/2) of q to (0, 1)
+template<typename Scalar>
+std::vector<Scalar> halve(const std::vector<Scalar> &q) {
+    std::vector<Scalar> result = q;
+    size_t n = q.size() - 1;
+    for (size_t i = 0; i < n; ++i)
+        multiply_pow2(result[i], unsigned(n - i));
+    normalize(result);
+    return result;
+}
+
+template<typename Scalar>
+std::vector<Scalar> derivative(const std::vector<Scalar> &q) {
+    std::vector<Scalar> result;
+    for (size_t i = 1; i < q.size(); ++i)
+        result.push_back(q[i] * Scalar(i));
+    return result;
+}
+
+template<typename Scalar>
+int sign_at_one(const std::vector<Scalar> &q) {
+    Scalar sum = Scalar(0);
+    for (auto &c : q)
+        sum += c;
+    return scalar_sign(sum);
+}
+
+// q(x) / (x - 1) by synthetic division, where q(1) = 0
+template<typename Scalar>
+std::vector<Scalar> divide_by_x_minus_one(const std::vector<Scalar> &q) {
+    std::vector<Scalar> result(q.size() - 1);
+    result.back() = q.back();
+    for (size_t i = result.size() - 1; i > 0; --i)
+        result[i - 1] = q[i] + result[i];
+    return result;
+}
+
+// Sturm sequence of q, built with pseudo-remainders scaled by positive
+// factors so that the signs are those of the true remainders
+template<typename Scalar>
+std::vector<std::vector<Scalar>> sturm_sequence(const std::vector<Scalar> &q) {
+    std::vector<std::vector<Scalar>> sequence = {q, derivative(q)};
+    while (sequence.back().size() > 1) {
+        std::vector<Scalar> remainder = sequence[sequence.size() - 2];
+        const std::vector<Scalar> &divisor = sequence.back();
+        Scalar lead = divisor.back();
+        Scalar abs_lead = scalar_sign(lead) < 0 ? Scalar(0) - lead : lead;
+
+        while (remainder.size() >= divisor.size()) {
+            // remainder = |lead| remainder - sign(lead) top x^shift divisor
+            Scalar top = scalar_sign(lead) < 0 ? Scalar(0) - remainder.back() : remainder.back();
+            size_t shift = remainder.size() - divisor.size();
+            for (auto &c : remainder)
+                c = c * abs_lead;
+            for (size_t i = 0; i + 1 < divisor.size(); ++i)
+                remainder[i + shift] -= top * divisor[i];
+            remainder.pop_back();
+            while (!remainder.empty() && scalar_sign(remainder.back()) == 0)
+                remainder.pop_back();
+            normalize(remainder);
+        }
+
+        if (remainder.empty())
+            break;
+        for (auto &c : remainder)
+            c = Scalar(0) - c;
+        sequence.push_back(std::move(remainder));
+    }
+    return sequence;
+}
+
+// Sign of s just right of a / 2^j, given by the first nonzero derivative
+template<typename Scalar>
+int sign_after(const std::vector<Scalar> &s, const Scalar &a, unsigned j) {
+    std::vector<Scalar> d = s;
+    while (!d.empty()) {
+        int sign = sign_at(d, a, j);
+        if (sign != 0)
+            return sign;
+        d = derivative(d);
+    }
+    return 0;
+}
+
+// Sign variations of a Sturm sequence just right of a / 2^j
+template<typename Scalar>
+int sturm_variations(const std::vector<std::vector<Scalar>> &sequence, const Scalar &a, unsigned j) {
+    int variations = 0, last = 0;
+    for (auto &s : sequence) {
+        int sign = sign_after(s, a, j);
+        if (sign != 0) {
+            variations += last != 0 && sign != last;
+            last = sign;
+        }
+    }
+    return variations;
+}
+
+// Polynomial q whose unit interval is (c / 2^k, (c + 1) / 2^k) of the
+// scaled polynomial, with the Sturm sequence of q if it is needed
+template<typename Scalar>
+struct RootSegment {
+    std::vector<Scalar> q;
+    Scalar c;
+    unsigned k;
+    std::vector<std::vector<Scalar>> sturm;
+};
+
+// Root in (a / 2^j, (a + 1) / 2^j) of the unit interval of a segment,
+// or exactly at a / 2^j
+template<typename Scalar>
+struct IsolatedRoot {
+    std::shared_ptr<const RootSegment<Scalar>> segment;
+    Scalar a;
+    unsigned j;
+    bool exact;
+};
+
+template<typename Scalar>
+class RootIsolator {
+ private:
+    typedef std::shared_ptr<const RootSegment<Scalar>> Segment;
+
+    static const unsigned max_descartes_depth = 48;
+    static const unsigned max_sturm_depth = std::is_same<Scalar, BigInt>::value ? 4096 : std::numeric_limits<long double>::digits;
+
+    std::vector<IsolatedRoot<Scalar>> isolated;
+
+    static Scalar twice(const Scalar &x) {
+        Scalar result = x;
+        multiply_pow2(result, 1);
+        return result;
+    }
+
+    void descartes(std::vector<Scalar> q, const Scalar &c, unsigned k) {
+        if (scalar_sign(q[0]) == 0) {
+            isolated.push_back({std::make_shared<RootSegment<Scalar>>(RootSegment<Scalar>{{}, c, k, {}}),
+                                Scalar(0), 0, true});
+            while (q.size() > 1 && scalar_sign(q[0]) == 0)
+                q.erase(q.begin());
+        }
+        if (q.size() <= 1)
+            return;
+
+        int variations = descartes_bound(q);
+        if (variations == 0)
+            return;
+        if (variations == 1) {
+            isolated.push_back({std::make_shared<RootSegment<Scalar>>(RootSegment<Scalar>{std::move(q), c, k, {}}),
+                                Scalar(0), 0, false});
+            return;
+        }
+        if (k >= max_descartes_depth) {
+            sturm(std::move(q), c, k);
+            return;
+        }
+
+        std::vector<Scalar> left = halve(q), right = left;
+        taylor_shift(right);
+        normalize(right);
+        Scalar left_c = twice(c);
+        descartes(std::move(left), left_c, k + 1);
+        descartes(std::move(right), left_c + Scalar(1), k + 1);
+    }
+
+    void sturm(std::vector<Scalar> q, const Scalar &c, unsigned k) {
+        // A root at the right end is found as the left end of the next interval
+        while (q.size() > 1 && sign_at_one(q) == 0)
+            q = divide_by_x_minus_one(q);
+        if (q.size() <= 1)
+            return;
+
+        auto sequence = sturm_sequence(q);
+        auto segment = std::make_shared<RootSegment<Scalar>>(RootSegment<Scalar>{std::move(q), c, k, std::move(sequence)});
+        int lo = sturm_variations(segment->sturm, Scalar(0), 0);
+        int hi = sturm_variations(segment->sturm, Scalar(1), 0);
+        sturm_bisect(segment, Scalar(0), 0, lo, hi);
+    }
+
+    // Isolate the lo - hi distinct roots in (a / 2^j, (a + 1) / 2^j]
+    void sturm_bisect(const Segment &segment, const Scalar &a, unsigned j, int lo, int hi) {
+        if (lo - hi <= 0)
+            return;
+        if (lo - hi == 1 || j >= max_sturm_depth) {
+            isolated.push_back({segment, a, j, false});
+            return;
+        }
+
+        Scalar left = twice(a), middle = left + Scalar(1);
+        bool root = sign_at(segment->q, middle, j + 1) == 0;
+        int mid = sturm_variations(segment->sturm, middle, j + 1);
+        sturm_bisect(segment, left, j + 1, lo, mid + root);
+        if (root)
+            isolated.push_back({segment, middle, j + 1, true});
+        sturm_bisect(segment, middle, j + 1, mid, hi);
+    }
+
+ public:
+    // Isolate the roots of q in (0, 1), where q(1) != 0
+    explicit RootIsolator(std::vector<Scalar> q) {
+        descartes(std::move(q), Scalar(0), 0);
+    }
+
+    const std::vector<IsolatedRoot<Scalar>> &roots() const {
+        return isolated;
+    }
+
+    // Bisect an isolating interval until it is at most 2^-bits wide and
+    // return the root's position in (0, 1)
+    static long double refine(IsolatedRoot<Scalar> root, unsigned bits) {
+        const RootSegment<Scalar> &segment = *root.segment;
+        const unsigned max_depth = std::is_same<Scalar, BigInt>::value ? std::numeric_limits<unsigned>::max()
+                                                                        : std::numeric_limits<long double>::digits;
+
+        if (!root.exact) {
+            // Simple roots change the sign of q, Sturm sequences count
+            // possibly multiple roots
+            bool simple = segment.sturm.empty();
+            int sign = simple ? sign_at(segment.q, root.a, root.j) : 0;
+            int lo = simple ? 0 : sturm_variations(segment.sturm, root.a, root.j);
+
+            while (segment.k + root.j < bits && root.j < max_depth) {
+                Scalar left = twice(root.a), middle = left + Scalar(1);
+                ++root.j;
+                int middle_sign = sign_at(segment.q, middle, root.j);
+                if (middle_sign == 0) {
+                    root.a = middle;
+                    root.exact = true;
+                    break;
+                }
+                bool in_left;
+                if (simple) {
+                    in_left = middle_sign != sign;
+                } else {
+                    int mid = sturm_variations(segment.sturm, middle, root.j);
+                    in_left = lo - mid >= 1;
+                    if (!in_left)
+                        lo = mid;
+                }
+                root.a = in_left ? left : middle;
+            }
+        }
+
+        long double offset = std::ldexp(to_long_double(root.a) + (root.exact ? 0.0L : 0.5L), -int(root.j));
+        return std::ldexp(to_long_double(segment.c) + offset, -int(segment.k));
+    }
+};
+
+// Append the positive roots of p in ascending order, where p(0) != 0
+template<typename Scalar, typename R>
+void positive_real_roots(std::vector<Scalar> p, double precision, std::vector<R> &roots) {
+    if (p.size() <= 1)
+        return;
+
+    // By Fujiwara's bound all roots are below 2 max |p_i / p_n|^(1 / (n - i)),
+    // and |p_i / p_n| < 2^(bit_length(p_i) - bit_length(p_n) + 1)
+    int n = int(p.size() - 1), lead = bit_length(p.back()), largest = std::numeric_limits<int>::min();
+    for (int i = 0; i < n; ++i) {
+        if (scalar_sign(p[i]) != 0) {
+            int e = bit_length(p[i]) - lead + 1, d = n - i;
+            largest = std::max(largest, e >= 0 ? (e + d - 1) / d : e / d);
+        }
+    }
+    int bound = std::max(largest + 1, 0);
+
+    // Roots of p in (0, 2^bound) are the roots of p(2^bound x) in (0, 1)
+    scale_variable(p, unsigned(bound));
+
+    // Interval width 2^(bound - bits) within twice the precision
+    int bits = bound - std::ilogb(2 * precision);
+    RootIsolator<Scalar> isolator(std::move(p));
+    for (auto &root : isolator.roots()) {
+        long double x = RootIsolator<Scalar>::refine(root, unsigned(std::max(bits, 0)));
+        roots.push_back(R(std::ldexp(x, bound)));
+    }
+}
+
+template<typename T>
+using RealRootScalar = std::conditional_t<std::is_integral<T>::value, BigInt, long double>;
+
+} // namespace detail
+
+// Distinct real roots of p in ascending order, each within precision of
+// the exact root. Root isolation is exact for integer coefficients.
+template<typename T>
+std::vector<std::common_type_t<T, double>> real_roots(const Polynomial<T> &p, double precision = 1e-12) {
+    static_assert(std::is_integral<T>::value || std::is_floating_point<T>::value,
+                  "real_roots needs real coefficients");
+    typedef detail::RealRootScalar<T> Scalar;
+    typedef std::common_type_t<T, double> R;
+
+    // Polynomial(T) keeps a zero constant term
+    auto first = std::find_if(p.begin(), p.end(), [](auto &term) { return term.second != T(); });
+    if (first == p.end())
+        throw std::invalid_argument("real_roots: zero polynomial");
+    if (!(precision > 0))
+        throw std::invalid_argument("real_roots: precision must be positive");
+
+    // p = x^low q with q(0) != 0
+    unsigned low = first->first;
+    std::vector<Scalar> q(p.degree() - low + 1, Scalar(0)), reflected;
+    for (auto it = first; it != p.end(); ++it)
+        q[it->first - low] = Scalar(it->second);
+    reflected = q;
+    for (size_t i = 1; i < reflected.size(); i += 2)
+        reflected[i] = Scalar(0) - reflected[i];
+
+    std::vector<R> roots;
+    detail::positive_real_roots(std::move(reflected), precision, roots);
+    for (auto &root : roots)
+        root = -root;
+    std::reverse(roots.begin(), roots.end());
+    if (low > 0)
+        roots.push_back(R(0));
+    detail::positive_real_roots(std::move(q), precision, roots);
+    return roots;
+}
+
+// Complex roots with the Aberth-Ehrlich method.
+//
+// All roots are approximated simultaneously. Each step moves every
+// approximation z_k by w_k = N_k / (1 - N_k S_k), where N_k = p(z_k) /
+// p'(z_k) is the Newton correction and S_k the sum of 1 / (z_k - z_j) over
+// the other approximations. The steps of one iteration only read the
+// approximations of the previous iteration, so they are split across
+// threads and the result doesn't depend on the number of threads.
+// Initial approximations are placed on circles whose radii come from the
+// Newton polygon of the coefficients. Converged roots are polished with
+// Newton steps in long double.
+
+namespace detail {
+
+template<typename T>
+struct RealPart {
+    typedef T type;
+};
+
+template<typename U>
+struct RealPart<std::complex<U>> {
+    typedef U type;
+};
+
+template<typename T>
+using ComplexRoot = std::complex<std::common_type_t<typename RealPart<T>::type, double>>;
+
+template<typename R>
+class AberthSolver {
+ private:
+    typedef std::complex<R> C;
+    typedef std::complex<long double> Wide;
+
+    static const unsigned max_iterations = 500;
+
+    // Coefficients of p in ascending order with p(0) != 0, and of p' for
+    // the polishing steps
+    std::vector<C> a;
+    std::vector<Wide> polish_p, polish_dp;
+    size_t n;
+
+    // Approximations of the current and the next iteration, split in real
+    // and imaginary parts so that the sums over all roots vectorize
+    std::vector<R> re, im, next_re, next_im;
+    std::vector<char> converged;
+
+    // p(z) / p'(z) with p and p' evaluated in the same Horner pass. Returns
+    // false at a critical point, where p'(z) = 0 but p(z) != 0.
+    bool newton_ratio(C z, C &ratio) const {
+        ratio = 0;
+        if (std::abs(z) <= 1) {
+            C value = a[n], slope = 0;
+            for (size_t i = n; i-- > 0;) {
+                slope = slope * z + value;
+                value = value * z + a[i];
+            }
+            if (value == C(0))
+                return true;
+            if (slope == C(0))
+                return false;
+            ratio = value / slope;
+            return true;
+        }
+
+        // p(z) = z^n q(1 / z) with the coefficients of q reversed, which
+        // doesn't overflow for large z. Then p / p' = z / (n - w q' / q).
+        C w = C(1) / z, value = a[0], slope = 0;
+        for (size_t i = 1; i <= n; ++i) {
+            slope = slope * w + value;
+            value = value * w + a[i];
+        }
+        if (value == C(0))
+            return true;
+        C denominator = R(n) - w * slope / value;
+        if (denominator == C(0))
+            return false;
+        ratio = z / denominator;
+        return true;
+    }
+
+    // log |p(z)|, and the Newton correction from p and p'
+    long double polish_state(Wide z, Wide &correction) const {
+        if (std::abs(z) <= 1) {
+            Wide value = 0, slope = 0;
+            for (size_t i = polish_p.size(); i-- > 0;)
+                value = value * z + polish_p[i];
+            for (size_t i = polish_dp.size(); i-- > 0;)
+                slope = slope * z + polish_dp[i];
+            correction = slope == Wide(0) ? Wide(0) : value / slope;
+            return std::log(std::abs(value));
+        }
+
+        // p(z) = z^n P(1 / z) and p'(z) = z^(n - 1) D(1 / z)
+        Wide w = Wide(1) / z, value = 0, slope = 0;
+        for (auto &c : polish_p)
+            value = value * w + c;
+        for (auto &c : polish_dp)
+            slope = slope * w + c;
+        correction = slope == Wide(0) ? Wide(0) : z * value / slope;
+        return n * std::log(std::abs(z)) + std::log(std::abs(value));
+    }
+
+    void initial_approximations() {
+        // Upper convex hull of the points (i, log |a_i|)
+        std::vector<size_t> hull;
+        auto height = [this](size_t i) { return std::log(std::abs(a[i])); };
+        for (size_t i = 0; i <= n; ++i) {
+            if (a[i] == C(0))
+                continue;
+            while (hull.size() >= 2) {
+                size_t i0 = hull[hull.size() - 2], i1 = hull.back();
+                R cross = R(i1 - i0) * (height(i) - height(i0)) - (height(i1) - height(i0)) * R(i - i0);
+                if (cross < 0)
+                    break;
+                hull.pop_back();
+            }
+            hull.push_back(i);
+        }
+
+        // Each edge from i to j of the hull gives j - i roots of modulus
+        // about (|a_i| / |a_j|)^(1 / (j - i))
+        const R two_pi = R(2) * std::acos(R(-1));
+        for (size_t e = 0; e + 1 < hull.size(); ++e) {
+            size_t i = hull[e], j = hull[e + 1], count = j - i;
+            R radius = std::exp((height(i) - height(j)) / R(count));
+            for (size_t m = 0; m < count; ++m) {
+                R angle = two_pi * (R(m) / R(count) + R(i) / R(n)) + R(0.4);
+                re.push_back(radius * std::cos(angle));
+                im.push_back(radius * std::sin(angle));
+            }
+        }
+    }
+
+    void step(size_t k) {
+        if (converged[k]) {
+            next_re[k] = re[k];
+            next_im[k] = im[k];
+            return;
+        }
+
+        C z(re[k], im[k]), ratio;
+        bool regular = newton_ratio(z, ratio);
+
+        // Sum of 1 / (z_k - z_j) = conj(z_k - z_j) / |z_k - z_j|^2
+        R sum_re = 0, sum_im = 0;
+        for (size_t j = 0; j < k; ++j) {
+            R dx = z.real() - re[j], dy = z.imag() - im[j], d = dx * dx + dy * dy;
+            sum_re += dx / d;
+            sum_im -= dy / d;
+        }
+        for (size_t j = k + 1; j < n; ++j) {
+            R dx = z.real() - re[j], dy = z.imag() - im[j], d = dx * dx + dy * dy;
+            sum_re += dx / d;
+            sum_im -= dy / d;
+        }
+
+        // At a critical point p / p' is infinite and the correction is its
+        // limit -1 / sum, or a small rotation away when that vanishes too
+        C sum(sum_re, sum_im), correction;
+        if (regular)
+            correction = ratio / (C(1) - ratio * sum);
+        else if (sum != C(0))
+            correction = -C(1) / sum;
+        else
+            correction = std::max(std::abs(z), R(1)) * R(1e-3) * C(R(0.6), R(0.8));
+        C next = z - correction;
+        next_re[k] = next.real();
+        next_im[k] = next.imag();
+        if (regular && std::abs(correction) <= 4 * std::numeric_limits<R>::epsilon() * std::abs(z))
+            converged[k] = 1;
+    }
+
+    void polish(size_t k) {
+        Wide z(re[k], im[k]), correction;
+        long double residual = polish_state(z, correction);
+        for (int i = 0; i < 2 && correction != Wide(0); ++i) {
+            Wide next = z - correction, next_correction;
+            long double next_residual = polish_state(next, next_correction);
+            if (!(next_residual < residual))
+                break;
+            z = next;
+            residual = next_residual;
+            correction = next_correction;
+        }
+        re[k] = R(z.real());
+        im[k] = R(z.imag());
+    }
+
+ public:
+    // p without roots at zero, and its derivative
+    AberthSolver(std::vector<C> coefficients, std::vector<Wide> derivative)
+        : a(std::move(coefficients)), polish_dp(std::move(derivative)), n(a.size() - 1) {
+        polish_p.assign(a.begin(), a.end());
+        re.reserve(n);
+        im.reserve(n);
+        initial_approximations();
+        next_re.resize(n);
+        next_im.resize(n);
+        converged.assign(n, 0);
+    }
+
+    // Run the iterations on a team of threads. The approximations are
+    // kept in buffers allocated once, so iterations don't allocate.
+    std::vector<C> solve(WorkerTeam &team) {
+        auto step_task = [this](size_t k) { step(k); };
+        auto polish_task = [this](size_t k) { polish(k); };
+        for (unsigned iteration = 0; iteration < max_iterations; ++iteration) {
+            team.run(n, step_task);
+            re.swap(next_re);
+            im.swap(next_im);
+            if (std::all_of(converged.begin(), converged.end(), [](char c) { return c != 0; }))
+                break;
+        }
+        team.run(n, polish_task);
+
+        std::vector<C> roots(n);
+        for (size_t k = 0; k < n; ++k)
+            roots[k] = C(re[k], im[k]);
+        return roots;
+    }
+};
+
+template<typename T>
+std::vector<ComplexRoot<T>> complex_roots(const Polynomial<T> &p, WorkerTeam &team) {
+    typedef ComplexRoot<T> C;
+    typedef typename C::value_type R;
+
+    // Polynomial(T) keeps a zero constant term
+    auto first = std::find_if(p.begin(), p.end(), [](auto &term) { return term.second != T(); });
+    if (first == p.end())
+        throw std::invalid_argument("complex_roots: zero polynomial");
+
+    // p = x^low q with q(0) != 0
+    unsigned low = first->first;
+    std::vector<C> q(p.degree() - low + 1, C(0));
+    for (auto it = first; it != p.end(); ++it)
+        q[it->first - low] = C(it->second);
+    std::vector<std::complex<long double>> dq(q.size() - 1, 0);
+
+    std::vector<C> roots(low, C(0));
+    if (q.size() > 1) {
+        // Derivative of q for the polishing steps
+        Polynomial<C> dense;
+        for (size_t i = 0; i < q.size(); ++i)
+            dense.add_term(unsigned(i), q[i]);
+        for (auto &term : dense.differentiate())
+            dq[term.first] = term.second;
+
+        auto solved = AberthSolver<R>(std::move(q), std::move(dq)).solve(team);
+        roots.insert(roots.end(), solved.begin(), solved.end());
+    }
+    return roots;
+}
+
+} // namespace detail
+
+// All complex roots of p, repeated according to their multiplicity, using
+// up to `threads` threads
+template<typename T>
+std::vector<detail::ComplexRoot<T>> complex_roots(const Polynomial<T> &p,
+                                                  unsigned threads = detail::default_thread_count()) {
+    // Small problems don't pay for synchronizing threads every iteration
+    const size_t min_parallel_degree = 256;
+    detail::WorkerTeam team(p.degree() < min_parallel_degree ? 1 : threads);
+    return detail::complex_roots(p, team);
+}
+
+// All complex roots of p using the workers of a thread pool, which are
+// free for other tasks between iterations
+template<typename T>
+std::vector<detail::ComplexRoot<T>> complex_roots(const Polynomial<T> &p, ThreadPool &pool) {
+    detail::WorkerTeam team(pool);
+    return detail::complex_roots(p, team);
+}
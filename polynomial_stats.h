@@ -0,0 +1,214 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+// Operation counters for profiling polynomial workloads.
+//
+// Compiled out unless POLYNOMIAL_INSTRUMENTATION is defined before
+// including polynomial.h. When enabled, every instrumented operation
+// records its call count, number of input terms, number of term
+// allocations and wall time. Counters are kept per thread, so updating
+// them needs no synchronization, and are summed up on demand by
+// polynomial_stats_snapshot().
+
+enum class PolynomialOperation {
+    Multiply,
+    Add,
+    Evaluate,
+    Differentiate
+};
+
+const size_t polynomial_operation_count = 4;
+
+inline const char *operation_name(PolynomialOperation operation) {
+    static const char *names[polynomial_operation_count] = {
+        "operator*", "operator+", "operator()", "differentiate"
+    };
+    return names[size_t(operation)];
+}
+
+struct OperationStats {
+    uint64_t calls = 0;
+    uint64_t terms = 0;
+    uint64_t allocations = 0;
+    uint64_t nanoseconds = 0;
+};
+
+struct PolynomialStats {
+    std::array<OperationStats, polynomial_operation_count> operations;
+
+    OperationStats &operator[] (PolynomialOperation operation) {
+        return operations[size_t(operation)];
+    }
+
+    const OperationStats &operator[] (PolynomialOperation operation) const {
+        return operations[size_t(operation)];
+    }
+};
+
+namespace detail {
+
+// Counters of one thread. Only the owning thread writes them, other
+// threads read them when taking a snapshot.
+struct ThreadStats {
+    struct Counters {
+        std::atomic<uint64_t> calls{0}, terms{0}, allocations{0}, nanoseconds{0};
+    };
+    std::array<Counters, polynomial_operation_count> operations;
+
+    // Allocations made by this thread through the counting resource
+    std::atomic<uint64_t> allocations{0};
+
+    static void add(std::atomic<uint64_t> &counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    void add_to(PolynomialStats &stats) const {
+        for (size_t i = 0; i < polynomial_operation_count; ++i) {
+            stats.operations[i].calls += operations[i].calls.load(std::memory_order_relaxed);
+            stats.operations[i].terms += operations[i].terms.load(std::memory_order_relaxed);
+            stats.operations[i].allocations += operations[i].allocations.load(std::memory_order_relaxed);
+            stats.operations[i].nanoseconds += operations[i].nanoseconds.load(std::memory_order_relaxed);
+        }
+    }
+
+    void reset() {
+        for (auto &counters : operations) {
+            counters.calls = 0;
+            counters.terms = 0;
+            counters.allocations = 0;
+            counters.nanoseconds = 0;
+        }
+    }
+};
+
+// Live threads' counters, plus the totals of threads that have exited
+struct StatsRegistry {
+    std::mutex mutex;
+    std::vector<ThreadStats *> threads;
+    PolynomialStats retired;
+
+    static StatsRegistry &instance() {
+        static StatsRegistry registry;
+        return registry;
+    }
+};
+
+// Registers the thread's counters on first use and folds them into the
+// retired totals when the thread exits
+struct ThreadStatsHandle {
+    ThreadStats stats;
+
+    ThreadStatsHandle() {
+        auto &registry = StatsRegistry::instance();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.threads.push_back(&stats);
+    }
+
+    ~ThreadStatsHandle() {
+        auto &registry = StatsRegistry::instance();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        stats.add_to(registry.retired);
+        for (auto &thread : registry.threads) {
+            if (thread == &stats) {
+                thread = registry.threads.back();
+                registry.threads.pop_back();
+                break;
+            }
+        }
+    }
+};
+
+inline ThreadStats &thread_stats() {
+    static thread_local ThreadStatsHandle handle;
+    return handle.stats;
+}
+
+// Pass-through resource counting the allocations of the calling thread
+class CountingResource : public std::pmr::memory_resource {
+ private:
+    std::pmr::memory_resource *upstream;
+
+    void *do_allocate(size_t bytes, size_t alignment) override {
+        ThreadStats::add(thread_stats().allocations, 1);
+        return upstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+        upstream->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+ public:
+    explicit CountingResource(std::pmr::memory_resource *upstream) : upstream(upstream)
+    {}
+};
+
+} // namespace detail
+
+// Default memory resource of polynomials in instrumented builds
+inline std::pmr::memory_resource *polynomial_counting_resource() {
+    static detail::CountingResource resource(std::pmr::get_default_resource());
+    return &resource;
+}
+
+// Records one call of an operation over its lifetime
+class PolynomialOperationTimer {
+ private:
+    typedef std::chrono::steady_clock clock;
+
+    PolynomialOperation operation;
+    uint64_t allocations_at_start;
+    clock::time_point start;
+
+ public:
+    PolynomialOperationTimer(PolynomialOperation operation, size_t terms)
+        : operation(operation),
+          allocations_at_start(detail::thread_stats().allocations.load(std::memory_order_relaxed)),
+          start(clock::now()) {
+        auto &counters = detail::thread_stats().operations[size_t(operation)];
+        detail::ThreadStats::add(counters.calls, 1);
+        detail::ThreadStats::add(counters.terms, terms);
+    }
+
+    PolynomialOperationTimer(PolynomialOperationTimer const &) = delete;
+    PolynomialOperationTimer &operator= (PolynomialOperationTimer const &) = delete;
+
+    ~PolynomialOperationTimer() {
+        auto &stats = detail::thread_stats();
+        auto &counters = stats.operations[size_t(operation)];
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+        detail::ThreadStats::add(counters.nanoseconds, elapsed.count());
+        detail::ThreadStats::add(counters.allocations,
+            stats.allocations.load(std::memory_order_relaxed) - allocations_at_start);
+    }
+};
+
+// Sum of the counters of all threads, including threads that have exited
+inline PolynomialStats polynomial_stats_snapshot() {
+    auto &registry = detail::StatsRegistry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    PolynomialStats stats = registry.retired;
+    for (auto thread : registry.threads)
+        thread->add_to(stats);
+    return stats;
+}
+
+// Zero the counters of all threads. Operations running concurrently may
+// be partially counted.
+inline void polynomial_stats_reset() {
+    auto &registry = detail::StatsRegistry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.retired = PolynomialStats();
+    for (auto thread : registry.threads)
+        thread->reset();
+}
@@ -0,0 +1,219 @@
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "polynomial.h"
+#include "polynomial_binary.h"
+
+// File of polynomials in the binary format of polynomial_binary.h,
+// opened with mmap so that polynomials are read straight from the page
+// cache on access. Opening a store only maps it, and resident memory is
+// bounded by the pages that are actually touched.
+//
+// Layout:
+//
+//   StoreHeader                  32 bytes
+//   binary records               8-byte aligned, see polynomial_binary.h
+//   index                        count * uint64 record offsets
+
+struct StoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t index_offset;
+};
+
+static_assert(sizeof(StoreHeader) == 32, "unexpected StoreHeader padding");
+
+namespace detail {
+
+const char store_magic[8] = {'P', 'O', 'L', 'Y', 'S', 'T', 'O', 'R'};
+const uint32_t store_version = 1;
+
+inline std::system_error store_error(const std::string &what) {
+    return std::system_error(errno, std::generic_category(), what);
+}
+
+} // namespace detail
+
+// Writes polynomials to a new store file. The index is written by
+// finish(), which the destructor calls if needed.
+template<typename T>
+class PolynomialStoreWriter {
+ private:
+    std::FILE *file;
+    std::vector<uint64_t> offsets;
+    uint64_t offset;
+    std::vector<char> buffer;
+
+    void write(const void *data, size_t size) {
+        if (std::fwrite(data, 1, size, file) != size)
+            throw detail::store_error("PolynomialStoreWriter: write failed");
+        offset += size;
+    }
+
+ public:
+    explicit PolynomialStoreWriter(const std::string &path)
+        : file(std::fopen(path.c_str(), "wb")), offset(0) {
+        if (!file)
+            throw detail::store_error("PolynomialStoreWriter: cannot open " + path);
+
+        // Placeholder, rewritten by finish()
+        StoreHeader header = {};
+        write(&header, sizeof(header));
+    }
+
+    PolynomialStoreWriter(PolynomialStoreWriter const &) = delete;
+    PolynomialStoreWriter &operator= (PolynomialStoreWriter const &) = delete;
+
+    ~PolynomialStoreWriter() {
+        if (file) {
+            try {
+                finish();
+            } catch (...) {
+                if (file)
+                    std::fclose(file);
+            }
+        }
+    }
+
+    // Append a polynomial, returns its id
+    size_t add(const Polynomial<T> &p) {
+        buffer.clear();
+        write_binary(p, buffer);
+        offsets.push_back(offset);
+        write(buffer.data(), buffer.size());
+        return offsets.size() - 1;
+    }
+
+    size_t size() const {
+        return offsets.size();
+    }
+
+    // Write the index and header and close the file
+    void finish() {
+        if (!file)
+            return;
+
+        StoreHeader header = {};
+        std::memcpy(header.magic, detail::store_magic, 8);
+        header.version = detail::store_version;
+        header.count = offsets.size();
+        header.index_offset = offset;
+        write(offsets.data(), offsets.size() * sizeof(uint64_t));
+
+        if (std::fseek(file, 0, SEEK_SET) != 0)
+            throw detail::store_error("PolynomialStoreWriter: seek failed");
+        write(&header, sizeof(header));
+
+        std::FILE *f = file;
+        file = nullptr;
+        if (std::fclose(f) != 0)
+            throw detail::store_error("PolynomialStoreWriter: close failed");
+    }
+};
+
+// Read-only store of polynomials mapped into memory. Views returned by
+// the store point into the mapping and are valid while the store is open.
+template<typename T>
+class PolynomialStore {
+ private:
+    const char *data = nullptr;
+    size_t size_bytes = 0;
+    StoreHeader header = {};
+
+    void close() {
+        if (data)
+            munmap(const_cast<char *>(data), size_bytes);
+        data = nullptr;
+    }
+
+ public:
+    explicit PolynomialStore(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw detail::store_error("PolynomialStore: cannot open " + path);
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw detail::store_error("PolynomialStore: cannot stat " + path);
+        }
+        size_bytes = st.st_size;
+        if (size_bytes < sizeof(StoreHeader)) {
+            ::close(fd);
+            throw BinaryFormatError("PolynomialStore: truncated header");
+        }
+
+        void *mapping = mmap(nullptr, size_bytes, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+            throw detail::store_error("PolynomialStore: cannot map " + path);
+        data = static_cast<const char *>(mapping);
+
+        // Access is by id, so don't read ahead
+        madvise(mapping, size_bytes, MADV_RANDOM);
+
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, detail::store_magic, 8) != 0 ||
+            header.version != detail::store_version ||
+            header.index_offset < sizeof(StoreHeader) ||
+            header.index_offset > size_bytes ||
+            header.count > (size_bytes - header.index_offset) / sizeof(uint64_t)) {
+            close();
+            throw BinaryFormatError("PolynomialStore: invalid store " + path);
+        }
+    }
+
+    PolynomialStore(PolynomialStore const &) = delete;
+    PolynomialStore &operator= (PolynomialStore const &) = delete;
+
+    PolynomialStore(PolynomialStore &&other)
+        : data(other.data), size_bytes(other.size_bytes), header(other.header) {
+        other.data = nullptr;
+    }
+
+    PolynomialStore &operator= (PolynomialStore &&other) {
+        if (this != &other) {
+            close();
+            data = other.data;
+            size_bytes = other.size_bytes;
+            header = other.header;
+            other.data = nullptr;
+        }
+        return *this;
+    }
+
+    ~PolynomialStore() {
+        close();
+    }
+
+    size_t size() const {
+        return header.count;
+    }
+
+    // View of the polynomial with the given id, without bounds checking
+    PolynomialView<T> operator[] (size_t id) const {
+        uint64_t offset;
+        std::memcpy(&offset, data + header.index_offset + id * sizeof(uint64_t), sizeof(offset));
+        if (offset < sizeof(StoreHeader) || offset >= header.index_offset)
+            throw BinaryFormatError("PolynomialStore: corrupt index");
+        return PolynomialView<T>(data + offset, header.index_offset - offset);
+    }
+
+    PolynomialView<T> at(size_t id) const {
+        if (id >= size())
+            throw std::out_of_range("PolynomialStore: id out of range");
+        return (*this)[id];
+    }
+};
@@ -0,0 +1,429 @@
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include "polynomial.h"
+#include "polynomial_binary.h"
+
+// Streaming storage of coefficients for polynomials too large to hold in
+// memory as a Polynomial.
+//
+// A coefficient stream is a header followed by chunks of terms in
+// ascending order of exponent, ending with an empty chunk:
+//
+//   StreamHeader                 16 bytes
+//   chunk: uint32 count, count uint32 exponents, count coefficients
+//   ...
+//   uint32 0
+//
+// Streams are read and written sequentially, so they work on pipes as
+// well as on files. The out-of-core operations below work chunk by chunk
+// with memory bounded by the chunk size, and read the next chunk and
+// write the previous one in the background while computing.
+
+struct StreamHeader {
+    char magic[8];
+    uint16_t byte_order;
+    uint8_t version;
+    uint8_t coefficient_kind;
+    uint8_t coefficient_size;
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(StreamHeader) == 16, "unexpected StreamHeader padding");
+
+// Terms of one chunk in ascending order of exponent
+template<typename T>
+struct TermChunk {
+    std::vector<unsigned> exponents;
+    std::vector<T> coefficients;
+
+    size_t size() const {
+        return exponents.size();
+    }
+
+    void clear() {
+        exponents.clear();
+        coefficients.clear();
+    }
+};
+
+namespace detail {
+
+const char stream_magic[8] = {'P', 'O', 'L', 'Y', 'S', 'T', 'R', 'M'};
+const uint8_t stream_version = 1;
+
+inline std::system_error stream_error(const std::string &what) {
+    return std::system_error(errno, std::generic_category(), what);
+}
+
+} // namespace detail
+
+// Reads the chunks of a coefficient stream. Takes ownership of the file
+// only when opened from a path.
+//
+// Chunk counts and exponents read from the stream are validated: a chunk
+// larger than the rest of a seekable file, or exponents that don't
+// increase, throw BinaryFormatError. On pipes, whose size isn't known,
+// chunks are read in pieces so that a corrupt count fails as a truncated
+// stream rather than allocating the count up front.
+template<typename T>
+class CoefficientReader {
+ private:
+    std::FILE *file;
+    bool owned;
+    bool finished = false;
+    // Bytes left in the file, or the maximum if unknown
+    uint64_t remaining = std::numeric_limits<uint64_t>::max();
+    bool any_terms = false;
+    unsigned last_exponent = 0;
+
+    void read(void *data, size_t size) {
+        if (std::fread(data, 1, size, file) != size) {
+            if (std::ferror(file))
+                throw detail::stream_error("CoefficientReader: read failed");
+            throw BinaryFormatError("coefficient stream: truncated");
+        }
+        if (remaining != std::numeric_limits<uint64_t>::max())
+            remaining -= size;
+    }
+
+    // Read count values into v, growing it at most a piece at a time
+    template<typename V>
+    void read_values(std::vector<V> &v, size_t count) {
+        const size_t piece = 1 << 16;
+        v.clear();
+        for (size_t done = 0; done < count; ) {
+            size_t n = remaining == std::numeric_limits<uint64_t>::max() ? std::min(piece, count - done)
+                                                                          : count - done;
+            v.resize(done + n);
+            read(v.data() + done, n * sizeof(V));
+            done += n;
+        }
+    }
+
+    // Size of the rest of the file if it can be seeked
+    void measure_remaining() {
+        long position = std::ftell(file);
+        if (position < 0 || std::fseek(file, 0, SEEK_END) != 0)
+            return;
+        long end = std::ftell(file);
+        if (std::fseek(file, position, SEEK_SET) != 0)
+            throw detail::stream_error("CoefficientReader: seek failed");
+        if (end >= position)
+            remaining = uint64_t(end - position);
+    }
+
+    void read_header() {
+        StreamHeader header;
+        read(&header, sizeof(header));
+        if (std::memcmp(header.magic, detail::stream_magic, 8) != 0)
+            throw BinaryFormatError("coefficient stream: bad magic");
+        if (header.byte_order != detail::binary_byte_order)
+            throw BinaryFormatError("coefficient stream: byte order mismatch");
+        if (header.version != detail::stream_version)
+            throw BinaryFormatError("coefficient stream: unsupported version");
+        if (header.coefficient_kind != detail::CoefficientKind<T>::value ||
+            header.coefficient_size != sizeof(T))
+            throw BinaryFormatError("coefficient stream: coefficient type mismatch");
+        measure_remaining();
+    }
+
+ public:
+    explicit CoefficientReader(std::FILE *file) : file(file), owned(false) {
+        read_header();
+    }
+
+    explicit CoefficientReader(const std::string &path)
+        : file(std::fopen(path.c_str(), "rb")), owned(true) {
+        if (!file)
+            throw detail::stream_error("CoefficientReader: cannot open " + path);
+        try {
+            read_header();
+        } catch (...) {
+            std::fclose(file);
+            throw;
+        }
+    }
+
+    CoefficientReader(CoefficientReader const &) = delete;
+    CoefficientReader &operator= (CoefficientReader const &) = delete;
+
+    ~CoefficientReader() {
+        if (owned)
+            std::fclose(file);
+    }
+
+    // Read the next chunk, returns false at the end of the stream
+    bool next_chunk(TermChunk<T> &chunk) {
+        chunk.clear();
+        if (finished)
+            return false;
+
+        uint32_t count;
+        read(&count, sizeof(count));
+        if (count == 0) {
+            finished = true;
+            return false;
+        }
+
+        // The chunk and the end marker must fit in the rest of the file
+        if (remaining != std::numeric_limits<uint64_t>::max() &&
+            uint64_t(count) * (sizeof(unsigned) + sizeof(T)) + sizeof(uint32_t) > remaining)
+            throw BinaryFormatError("coefficient stream: chunk larger than the remaining input");
+
+        read_values(chunk.exponents, count);
+        for (unsigned exponent : chunk.exponents) {
+            if (any_terms && exponent <= last_exponent)
+                throw BinaryFormatError("coefficient stream: exponents not increasing");
+            any_terms = true;
+            last_exponent = exponent;
+        }
+        read_values(chunk.coefficients, count);
+        return true;
+    }
+
+    // Read the rest of the stream into memory
+    Polynomial<T> read_all() {
+        Polynomial<T> result;
+        TermChunk<T> chunk;
+        while (next_chunk(chunk))
+            for (size_t i = 0; i < chunk.size(); ++i)
+                result.add_term(chunk.exponents[i], chunk.coefficients[i]);
+        return result;
+    }
+};
+
+// Writes terms in ascending order of exponent to a coefficient stream,
+// buffering them into chunks of chunk_terms terms. Takes ownership of
+// the file only when opened from a path. close() ends the stream and is
+// called by the destructor if needed.
+template<typename T>
+class CoefficientWriter {
+    static_assert(sizeof(unsigned) == 4, "coefficient streams store 32-bit exponents");
+
+ private:
+    std::FILE *file;
+    bool owned;
+    size_t chunk_terms;
+    TermChunk<T> chunk;
+    bool any_terms = false;
+    unsigned last_exponent = 0;
+
+    // Chunk being written in the background, if any
+    TermChunk<T> writing;
+    std::future<void> pending;
+
+    void write_bytes(const void *data, size_t size) {
+        if (std::fwrite(data, 1, size, file) != size)
+            throw detail::stream_error("CoefficientWriter: write failed");
+    }
+
+    void write_chunk(const TermChunk<T> &c) {
+        uint32_t count = uint32_t(c.size());
+        write_bytes(&count, sizeof(count));
+        write_bytes(c.exponents.data(), count * sizeof(unsigned));
+        write_bytes(c.coefficients.data(), count * sizeof(T));
+    }
+
+    void wait_pending() {
+        if (pending.valid())
+            pending.get();
+    }
+
+    void write_header() {
+        StreamHeader header = {};
+        std::memcpy(header.magic, detail::stream_magic, 8);
+        header.byte_order = detail::binary_byte_order;
+        header.version = detail::stream_version;
+        header.coefficient_kind = detail::CoefficientKind<T>::value;
+        header.coefficient_size = uint8_t(sizeof(T));
+        write_bytes(&header, sizeof(header));
+    }
+
+ public:
+    explicit CoefficientWriter(std::FILE *file, size_t chunk_terms = 1 << 16)
+        : file(file), owned(false), chunk_terms(chunk_terms) {
+        write_header();
+    }
+
+    explicit CoefficientWriter(const std::string &path, size_t chunk_terms = 1 << 16)
+        : file(std::fopen(path.c_str(), "wb")), owned(true), chunk_terms(chunk_terms) {
+        if (!file)
+            throw detail::stream_error("CoefficientWriter: cannot open " + path);
+        try {
+            write_header();
+        } catch (...) {
+            std::fclose(file);
+            throw;
+        }
+    }
+
+    CoefficientWriter(CoefficientWriter const &) = delete;
+    CoefficientWriter &operator= (CoefficientWriter const &) = delete;
+
+    ~CoefficientWriter() {
+        try {
+            close();
+        } catch (...) {
+        }
+        if (owned && file)
+            std::fclose(file);
+    }
+
+    // Append a term. Zero coefficients are skipped, exponents must be
+    // strictly increasing.
+    void write(unsigned exponent, T coefficient) {
+        if (coefficient == T())
+            return;
+        if (any_terms && exponent <= last_exponent)
+            throw std::invalid_argument("CoefficientWriter: exponents must be increasing");
+        any_terms = true;
+        last_exponent = exponent;
+
+        chunk.exponents.push_back(exponent);
+        chunk.coefficients.push_back(coefficient);
+        if (chunk.size() >= chunk_terms)
+            flush();
+    }
+
+    void write(const Polynomial<T> &p) {
+        for (auto &term : p)
+            write(term.first, term.second);
+    }
+
+    // Hand the buffered terms to a background write, waiting for the
+    // previous one first
+    void flush() {
+        if (!file)
+            throw std::logic_error("CoefficientWriter: stream is closed");
+        wait_pending();
+        if (chunk.size() == 0)
+            return;
+        std::swap(chunk, writing);
+        chunk.clear();
+        pending = std::async(std::launch::async, [this]() { write_chunk(writing); });
+    }
+
+    // Write the remaining terms and the end of the stream
+    void close() {
+        if (!file)
+            return;
+        flush();
+        wait_pending();
+
+        uint32_t end = 0;
+        write_bytes(&end, sizeof(end));
+        if (std::fflush(file) != 0)
+            throw detail::stream_error("CoefficientWriter: flush failed");
+        if (owned) {
+            std::FILE *f = file;
+            file = nullptr;
+            if (std::fclose(f) != 0)
+                throw detail::stream_error("CoefficientWriter: close failed");
+        } else {
+            file = nullptr;
+        }
+    }
+};
+
+namespace detail {
+
+// Iterates over the terms of a coefficient stream while the next chunk is
+// read in the background
+template<typename T>
+class TermCursor {
+ private:
+    CoefficientReader<T> &reader;
+    TermChunk<T> current, next;
+    std::future<bool> prefetch;
+    size_t index = 0;
+    bool more = true;
+
+    void start_prefetch() {
+        prefetch = std::async(std::launch::async, [this]() { return reader.next_chunk(next); });
+    }
+
+    void advance_chunk() {
+        while (index == current.size() && more) {
+            more = prefetch.get();
+            std::swap(current, next);
+            index = 0;
+            if (more)
+                start_prefetch();
+        }
+    }
+
+ public:
+    explicit TermCursor(CoefficientReader<T> &reader) : reader(reader) {
+        more = reader.next_chunk(current);
+        if (more)
+            start_prefetch();
+    }
+
+    TermCursor(TermCursor const &) = delete;
+    TermCursor &operator= (TermCursor const &) = delete;
+
+    ~TermCursor() {
+        if (prefetch.valid())
+            prefetch.wait();
+    }
+
+    bool done() const {
+        return index == current.size();
+    }
+
+    unsigned exponent() const {
+        return current.exponents[index];
+    }
+
+    const T &coefficient() const {
+        return current.coefficients[index];
+    }
+
+    void next_term() {
+        ++index;
+        advance_chunk();
+    }
+};
+
+} // namespace detail
+
+// Out-of-core lhs + rhs, merging the two streams term by term
+template<typename T>
+void stream_add(CoefficientReader<T> &lhs, CoefficientReader<T> &rhs, CoefficientWriter<T> &out) {
+    detail::TermCursor<T> a(lhs), b(rhs);
+    while (!a.done() || !b.done()) {
+        if (b.done() || (!a.done() && a.exponent() < b.exponent())) {
+            out.write(a.exponent(), a.coefficient());
+            a.next_term();
+        } else if (a.done() || b.exponent() < a.exponent()) {
+            out.write(b.exponent(), T() + b.coefficient());
+            b.next_term();
+        } else {
+            out.write(a.exponent(), a.coefficient() + b.coefficient());
+            a.next_term();
+            b.next_term();
+        }
+    }
+}
+
+// Out-of-core derivative
+template<typename T>
+void stream_differentiate(CoefficientReader<T> &in, CoefficientWriter<T> &out) {
+    for (detail::TermCursor<T> term(in); !term.done(); term.next_term()) {
+        if (term.exponent() > 0) {
+            T coefficient = term.coefficient();
+            coefficient *= term.exponent();
+            out.write(term.exponent() - 1, coefficient);
+        }
+    }
+}
@@ -0,0 +1,324 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <complex>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "polynomial.h"
+
+// Conversion of polynomials to and from text in the format written by
+// print(), e.g. "5x^2 + 3x - 7". Numbers are parsed with std::from_chars,
+// so parsing doesn't allocate besides the term buffer and the result.
+
+class ParseError : public std::runtime_error {
+ private:
+    size_t pos;
+
+ public:
+    ParseError(const std::string &what, size_t position)
+        : std::runtime_error(what + " at position " + std::to_string(position)), pos(position)
+    {}
+
+    // Offset of the error in the input
+    size_t position() const {
+        return pos;
+    }
+};
+
+namespace detail {
+
+// Parse a number starting at first, returns the end of the number or
+// nullptr if there is none
+template<typename T>
+struct CoefficientParser {
+    static const char *parse(const char *first, const char *last, T &value) {
+        auto result = std::from_chars(first, last, value);
+        return result.ec == std::errc() ? result.ptr : nullptr;
+    }
+};
+
+// Complex numbers in the (real,imaginary) format of operator<<
+template<typename U>
+struct CoefficientParser<std::complex<U>> {
+    static const char *parse(const char *first, const char *last, std::complex<U> &value) {
+        U re, im;
+        if (first == last || *first != '(')
+            return nullptr;
+        first = CoefficientParser<U>::parse(first + 1, last, re);
+        if (!first || first == last || *first != ',')
+            return nullptr;
+        first = CoefficientParser<U>::parse(first + 1, last, im);
+        if (!first || first == last || *first != ')')
+            return nullptr;
+        value = std::complex<U>(re, im);
+        return first + 1;
+    }
+};
+
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+} // namespace detail
+
+// Parse a polynomial written in the format of print(). Terms may appear in
+// any order and repeated exponents are summed. A term without coefficient
+// such as "x^2" or "-x" has coefficient 1 or -1. Throws ParseError with
+// the position of the first invalid character.
+template<typename T>
+Polynomial<T> parse(std::string_view text, std::string_view variable = "x") {
+    const char *begin = text.data();
+    const char *p = begin;
+    const char *end = begin + text.size();
+
+    auto skip_space = [&]() {
+        while (p != end && detail::is_space(*p))
+            ++p;
+    };
+    auto error = [&](const char *what) {
+        return ParseError(what, size_t(p - begin));
+    };
+    auto at_variable = [&]() {
+        return !variable.empty() && size_t(end - p) >= variable.size() &&
+               std::equal(variable.begin(), variable.end(), p);
+    };
+
+    std::vector<std::pair<unsigned, T>> terms;
+    bool first_term = true;
+
+    skip_space();
+    if (p == end)
+        throw error("expected a term");
+
+    while (p != end) {
+        bool negative = false;
+        if (!first_term) {
+            if (*p != '+' && *p != '-')
+                throw error("expected + or -");
+            negative = *p == '-';
+            ++p;
+            skip_space();
+        }
+
+        // A sign directly in front of the variable instead of a number
+        bool sign_only = false;
+        if (p != end && (*p == '-' || *p == '+')) {
+            const char *after_sign = p + 1;
+            if (!variable.empty() && size_t(end - after_sign) >= variable.size() &&
+                std::equal(variable.begin(), variable.end(), after_sign)) {
+                negative = negative != (*p == '-');
+                sign_only = true;
+                p = after_sign;
+            }
+        }
+
+        T coefficient = T(1);
+        if (!sign_only && !at_variable()) {
+            const char *number_end = detail::CoefficientParser<T>::parse(p, end, coefficient);
+            if (!number_end)
+                throw error("expected a coefficient");
+            p = number_end;
+            if (p != end && *p == '*')
+                ++p;
+        }
+
+        unsigned exponent = 0;
+        if (at_variable()) {
+            p += variable.size();
+            exponent = 1;
+            if (p != end && *p == '^') {
+                ++p;
+                auto result = std::from_chars(p, end, exponent);
+                if (result.ec != std::errc())
+                    throw error("expected an exponent");
+                p = result.ptr;
+            }
+        }
+
+        terms.emplace_back(exponent, negative ? T(-coefficient) : coefficient);
+        first_term = false;
+        skip_space();
+    }
+
+    // print() writes terms in descending order of exponent. Build the
+    // result in ascending order so every term is appended in constant time.
+    if (std::is_sorted(terms.rbegin(), terms.rend(),
+                       [](auto &a, auto &b) { return a.first < b.first; })) {
+        std::reverse(terms.begin(), terms.end());
+    } else {
+        std::stable_sort(terms.begin(), terms.end(),
+                         [](auto &a, auto &b) { return a.first < b.first; });
+    }
+
+    Polynomial<T> result;
+    for (auto &term : terms)
+        result.add_term(term.first, term.second);
+    return result;
+}
+
+// Formatting of polynomials without iostreams.
+//
+// PolynomialFormatter writes the same text as print() on a stream with
+// default formatting flags, using std::to_chars for the coefficients.
+// The variable suffixes ("x", "x^2", ...) of small exponents are
+// precomputed, so a formatter should be reused to format many
+// polynomials.
+
+namespace detail {
+
+template<typename T>
+struct CoefficientFormatter {
+    // Upper bound of the characters written for one coefficient
+    static const size_t max_chars = std::is_integral<T>::value ? std::numeric_limits<T>::digits10 + 3 : 32;
+
+    static char *write(char *first, char *last, T value) {
+        std::to_chars_result result;
+        if constexpr (std::is_floating_point<T>::value) {
+            // Same as printf("%.6g"), which is what operator<< does by default
+            result = std::to_chars(first, last, value, std::chars_format::general, 6);
+        } else {
+            result = std::to_chars(first, last, value);
+        }
+        return result.ec == std::errc() ? result.ptr : nullptr;
+    }
+};
+
+// (real,imaginary) as written by operator<<
+template<typename U>
+struct CoefficientFormatter<std::complex<U>> {
+    static const size_t max_chars = 2 * CoefficientFormatter<U>::max_chars + 3;
+
+    static char *write(char *first, char *last, std::complex<U> value) {
+        if (first == last)
+            return nullptr;
+        *first++ = '(';
+        first = CoefficientFormatter<U>::write(first, last, value.real());
+        if (!first || first == last)
+            return nullptr;
+        *first++ = ',';
+        first = CoefficientFormatter<U>::write(first, last, value.imag());
+        if (!first || first == last)
+            return nullptr;
+        *first++ = ')';
+        return first;
+    }
+};
+
+} // namespace detail
+
+template<typename T>
+class PolynomialFormatter {
+ private:
+    std::string variable;
+    std::string suffixes;
+    std::vector<size_t> suffix_offsets;
+
+    // Longest suffix of an exponent that isn't cached: variable^4294967295
+    size_t max_suffix() const {
+        return variable.size() + 11;
+    }
+
+    char *write_suffix(char *first, char *last, unsigned exponent) const {
+        if (size_t(exponent) + 1 < suffix_offsets.size()) {
+            size_t begin = suffix_offsets[exponent], length = suffix_offsets[exponent + 1] - begin;
+            if (size_t(last - first) < length)
+                return nullptr;
+            return std::copy_n(suffixes.data() + begin, length, first);
+        }
+
+        if (exponent == 0)
+            return first;
+        if (size_t(last - first) < variable.size() + (exponent > 1))
+            return nullptr;
+        first = std::copy(variable.begin(), variable.end(), first);
+        if (exponent == 1)
+            return first;
+        *first++ = '^';
+        auto result = std::to_chars(first, last, exponent);
+        return result.ec == std::errc() ? result.ptr : nullptr;
+    }
+
+    char *write_terms(char *first, char *last, const Polynomial<T> &p) const {
+        typedef detail::CoefficientFormatter<T> Coefficient;
+
+        // Handle zero polynomial
+        if (p.length() == 0)
+            return Coefficient::write(first, last, T());
+
+        bool leading = true;
+        for (auto it = std::make_reverse_iterator(p.end()); it != std::make_reverse_iterator(p.begin()); ++it) {
+            if (leading) {
+                first = Coefficient::write(first, last, it->second);
+                leading = false;
+            } else {
+                if (last - first < 3)
+                    return nullptr;
+                first = std::copy_n(tSign(it->second) ? " - " : " + ", 3, first);
+                first = Coefficient::write(first, last, tAbs(it->second));
+            }
+            if (!first)
+                return nullptr;
+            first = write_suffix(first, last, it->first);
+            if (!first)
+                return nullptr;
+        }
+        return first;
+    }
+
+ public:
+    // Suffixes of exponents below cached_exponents are precomputed
+    explicit PolynomialFormatter(std::string_view variable = "x", unsigned cached_exponents = 256)
+        : variable(variable) {
+        suffix_offsets.reserve(cached_exponents + 1);
+        char digits[16];
+        for (unsigned exponent = 0; exponent < cached_exponents; ++exponent) {
+            suffix_offsets.push_back(suffixes.size());
+            if (exponent > 0)
+                suffixes += variable;
+            if (exponent > 1) {
+                suffixes += '^';
+                suffixes.append(digits, std::to_chars(digits, digits + sizeof(digits), exponent).ptr);
+            }
+        }
+        suffix_offsets.push_back(suffixes.size());
+    }
+
+    // Upper bound of the characters written for p
+    size_t max_size(const Polynomial<T> &p) const {
+        return std::max<size_t>(1, p.length()) * (3 + detail::CoefficientFormatter<T>::max_chars + max_suffix());
+    }
+
+    // Write p into [first, last). Returns a pointer past the last written
+    // character with errc::value_too_large if the buffer is too small.
+    std::to_chars_result format(char *first, char *last, const Polynomial<T> &p) const {
+        char *end = write_terms(first, last, p);
+        if (!end)
+            return {last, std::errc::value_too_large};
+        return {end, std::errc()};
+    }
+
+    // Append the text of p to out
+    void append(std::string &out, const Polynomial<T> &p) const {
+        size_t offset = out.size();
+        out.resize(offset + max_size(p));
+        char *end = write_terms(&out[offset], &out[0] + out.size(), p);
+        out.resize(end - out.data());
+    }
+
+    std::string to_string(const Polynomial<T> &p) const {
+        std::string out;
+        append(out, p);
+        return out;
+    }
+};
+
+template<typename T>
+std::string to_string(const Polynomial<T> &p, std::string_view variable = "x") {
+    return PolynomialFormatter<T>(variable, 0).to_string(p);
+}
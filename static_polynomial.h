@@ -0,0 +1,197 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iosfwd>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "polynomial.h"
+
+// Polynomial with N coefficients (degree at most N-1) fixed at compile
+// time. Coefficients are stored densely in a std::array, indexed by
+// exponent, and all operations except conversion from a runtime
+// Polynomial are constexpr, so e.g. evaluation can be checked with
+// static_assert.
+template<typename T, size_t N>
+class StaticPolynomial {
+    static_assert(N > 0, "StaticPolynomial needs at least one coefficient");
+
+    template<typename, size_t> friend class StaticPolynomial;
+
+ private:
+    std::array<T, N> coefficients;
+
+    // Horner's scheme unrolled over the index sequence into straight-line code
+    template<typename U, size_t... I>
+    constexpr U horner(U value, std::index_sequence<I...>) const {
+        U result = U(coefficients[N - 1]);
+        ((result = result * value + coefficients[N - 2 - I]), ...);
+        return result;
+    }
+
+    template<typename U, size_t... I>
+    U horner_fma(U value, std::index_sequence<I...>) const {
+        U result = U(coefficients[N - 1]);
+        ((result = std::fma(result, value, U(coefficients[N - 2 - I]))), ...);
+        return result;
+    }
+
+ public:
+    constexpr StaticPolynomial() : coefficients{}
+    {}
+
+    // Coefficients in ascending order of exponent
+    constexpr StaticPolynomial(std::array<T, N> coefficients) : coefficients(coefficients)
+    {}
+
+    // Conversion from a runtime polynomial, which must have degree below N
+    explicit StaticPolynomial(const Polynomial<T> &p) : coefficients{} {
+        if (p.length() != 0 && p.degree() >= N)
+            throw std::length_error("StaticPolynomial: degree of polynomial exceeds capacity");
+        for (auto &term : p)
+            coefficients[term.first] = term.second;
+    }
+
+    Polynomial<T> to_polynomial() const {
+        Polynomial<T> result;
+        for (size_t i = 0; i < N; ++i)
+            result.add_term(unsigned(i), coefficients[i]);
+        return result;
+    }
+
+    explicit operator Polynomial<T>() const {
+        return to_polynomial();
+    }
+
+    static constexpr size_t size() {
+        return N;
+    }
+
+    // Highest exponent with a nonzero coefficient, 0 for the zero polynomial
+    constexpr unsigned degree() const {
+        for (size_t i = N; i-- > 1; )
+            if (coefficients[i] != T())
+                return unsigned(i);
+        return 0;
+    }
+
+    constexpr T coefficient(unsigned term) const {
+        return term < N ? coefficients[term] : T();
+    }
+
+    template<size_t M>
+    constexpr StaticPolynomial<T, (N > M ? N : M)> operator+ (const StaticPolynomial<T, M> &rhs) const {
+        StaticPolynomial<T, (N > M ? N : M)> result;
+        for (size_t i = 0; i < N; ++i)
+            result.coefficients[i] += coefficients[i];
+        for (size_t i = 0; i < M; ++i)
+            result.coefficients[i] += rhs.coefficients[i];
+        return result;
+    }
+
+    constexpr StaticPolynomial operator- () const {
+        StaticPolynomial result;
+        for (size_t i = 0; i < N; ++i)
+            result.coefficients[i] = -coefficients[i];
+        return result;
+    }
+
+    template<size_t M>
+    constexpr StaticPolynomial<T, (N > M ? N : M)> operator- (const StaticPolynomial<T, M> &rhs) const {
+        return *this + -rhs;
+    }
+
+    template<size_t M>
+    constexpr StaticPolynomial<T, N + M - 1> operator* (const StaticPolynomial<T, M> &rhs) const {
+        StaticPolynomial<T, N + M - 1> result;
+        for (size_t i = 0; i < N; ++i)
+            for (size_t j = 0; j < M; ++j)
+                result.coefficients[i + j] += coefficients[i] * rhs.coefficients[j];
+        return result;
+    }
+
+    // Arithmetic with constants
+    friend constexpr StaticPolynomial operator+ (const StaticPolynomial &lhs, T rhs) {
+        StaticPolynomial result(lhs);
+        result.coefficients[0] += rhs;
+        return result;
+    }
+
+    friend constexpr StaticPolynomial operator+ (T lhs, const StaticPolynomial &rhs) {
+        return rhs + lhs;
+    }
+
+    friend constexpr StaticPolynomial operator- (const StaticPolynomial &lhs, T rhs) {
+        return lhs + -rhs;
+    }
+
+    friend constexpr StaticPolynomial operator- (T lhs, const StaticPolynomial &rhs) {
+        return -rhs + lhs;
+    }
+
+    friend constexpr StaticPolynomial operator* (const StaticPolynomial &lhs, T rhs) {
+        StaticPolynomial result;
+        for (size_t i = 0; i < N; ++i)
+            result.coefficients[i] = lhs.coefficients[i] * rhs;
+        return result;
+    }
+
+    friend constexpr StaticPolynomial operator* (T lhs, const StaticPolynomial &rhs) {
+        StaticPolynomial result;
+        for (size_t i = 0; i < N; ++i)
+            result.coefficients[i] = lhs * rhs.coefficients[i];
+        return result;
+    }
+
+    constexpr StaticPolynomial<T, (N > 1 ? N - 1 : 1)> differentiate() const {
+        StaticPolynomial<T, (N > 1 ? N - 1 : 1)> result;
+        for (size_t i = 1; i < N; ++i)
+            result.coefficients[i - 1] = coefficients[i] * T(i);
+        return result;
+    }
+
+    // Equal if all coefficients match, treating missing ones as zero
+    template<size_t M>
+    constexpr bool operator== (const StaticPolynomial<T, M> &other) const {
+        for (size_t i = 0; i < (N > M ? N : M); ++i)
+            if (coefficient(unsigned(i)) != other.coefficient(unsigned(i)))
+                return false;
+        return true;
+    }
+
+    template<size_t M>
+    constexpr bool operator!= (const StaticPolynomial<T, M> &other) const {
+        return !(*this == other);
+    }
+
+    // evaluate the polynomial at a point
+    template<typename U>
+    constexpr U operator() (U value) const {
+        return horner(value, std::make_index_sequence<N - 1>());
+    }
+
+    // Evaluation with fused multiply-adds. Not constexpr since std::fma
+    // isn't, but rounds once per step instead of twice.
+    template<typename U>
+    U evaluate_fma(U value) const {
+        return horner_fma(value, std::make_index_sequence<N - 1>());
+    }
+
+    void print(std::ostream& os, const std::string &variable="x") const {
+        to_polynomial().print(os, variable);
+    }
+};
+
+// Deduce the size from a list of coefficients in ascending order of exponent
+template<typename T, typename... Ts>
+constexpr StaticPolynomial<T, 1 + sizeof...(Ts)> make_static_polynomial(T c0, Ts... rest) {
+    return StaticPolynomial<T, 1 + sizeof...(Ts)>(std::array<T, 1 + sizeof...(Ts)>{c0, T(rest)...});
+}
+
+template<typename T, size_t N>
+std::ostream& operator<< (std::ostream& os, StaticPolynomial<T, N> const &p) {
+    p.print(os);
+    return os;
+}
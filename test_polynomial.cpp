@@ -1,8 +1,45 @@
 #define CATCH_CONFIG_MAIN
+// Catch's alternate signal stack relies on MINSIGSTKSZ being a constant,
+// which is no longer the case with recent glibc
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
 #include "catch.hpp"
 #include "polynomial.h"
+#include "polynomial_memory.h"
+#include "polynomial_binary.h"
+#include "polynomial_parallel.h"
+#include "polynomial_store.h"
+#include "polynomial_stream.h"
+#include "polynomial_out_of_core.h"
+#include "polynomial_roots.h"
+#include "polynomial_interval.h"
+#include "polynomial_compensated.h"
+#include "polynomial_chebyshev.h"
+#include "polynomial_remez.h"
+#include "polynomial_fit.h"
+#include "polynomial_piecewise.h"
+#include "polynomial_multivariate.h"
+#include "polynomial_matrix.h"
+#include "polynomial_text.h"
+#include "static_polynomial.h"
+#include "thread_pool.h"
 #include <string>
 #include <sstream>
+#include <random>
+#include <filesystem>
+#include <chrono>
+#include <thread>
+
+// Polynomial with `length` random terms with exponents below `max_exponent`
+template<typename T>
+Polynomial<T> random_polynomial(size_t length, unsigned max_exponent, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<unsigned> exponent(0, max_exponent - 1);
+    std::uniform_int_distribution<int> coefficient(-100, 100);
+    Polynomial<T> p;
+    while (p.length() < length)
+        p.add_term(exponent(rng), T(coefficient(rng)) / T(7));
+    return p;
+}
 
 TEST_CASE( "Default constructor creates zero polynomial" ) {
     Polynomial<int> p;
@@ -219,4 +256,1450 @@ TEST_CASE( "Evaluation" ) {
     for (int i = -10; i <= 10; ++i) {
         REQUIRE( quadratic(i) == -2*i*i + i - 2 );
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE( "Evaluation with derivatives" ) {
+    Polynomial<int> p( {{0,3},{2,-2},{5,1},{9,4}} );
+    std::vector<Polynomial<int>> derivatives = {p};
+    for (int j = 0; j < 11; ++j)
+        derivatives.push_back(derivatives.back().differentiate());
+
+    for (long long x = -3; x <= 3; ++x) {
+        long long values[12];
+        p.evaluate_with_derivatives(x, 11, values);
+        for (int j = 0; j <= 11; ++j)
+            REQUIRE( values[j] == derivatives[j](x) );
+    }
+
+    auto fixed = p.evaluate_with_derivatives<2>(2.0);
+    REQUIRE( fixed[0] == p(2.0) );
+    REQUIRE( fixed[1] == derivatives[1](2.0) );
+    REQUIRE( fixed[2] == derivatives[2](2.0) );
+
+    double zero[3];
+    Polynomial<int>().evaluate_with_derivatives(1.5, 2, zero);
+    REQUIRE( (zero[0] == 0 && zero[1] == 0 && zero[2] == 0) );
+
+    // The batch form matches point by point
+    auto q = random_polynomial<double>(50, 200, 35);
+    std::vector<double> points, batch(4 * 37);
+    for (int i = 0; i < 37; ++i)
+        points.push_back(-1 + i / 18.0);
+    q.evaluate_with_derivatives(points.data(), points.size(), 3, batch.data());
+    for (size_t i = 0; i < points.size(); ++i) {
+        double values[4];
+        q.evaluate_with_derivatives(points[i], 3, values);
+        for (int j = 0; j <= 3; ++j)
+            REQUIRE( batch[j * points.size() + i] == values[j] );
+    }
+    REQUIRE( batch[37 + 5] == Approx(q.differentiate()(points[5])) );
+}
+
+TEST_CASE( "Read-only access to terms" ) {
+    const Polynomial<int> p( {{0,4},{2,2},{5,-1}} );
+
+    REQUIRE( p.degree() == 5 );
+    REQUIRE( p.coefficient(1) == 0 );
+    REQUIRE( p.length() == 3 );
+
+    std::map<unsigned,int> terms(p.begin(), p.end());
+    REQUIRE( terms == std::map<unsigned,int>({{0,4},{2,2},{5,-1}}) );
+}
+
+TEST_CASE( "Adding terms" ) {
+    Polynomial<int> p;
+    p.add_term(0, 1);
+    p.add_term(3, 2);
+    p.add_term(3, -2);
+    p.add_term(1, 5);
+
+    REQUIRE( p == Polynomial<int>({{0,1},{1,5}}) );
+}
+
+TEST_CASE( "Parallel multiplication matches serial multiplication" ) {
+    SECTION( "dense int" ) {
+        auto p = random_polynomial<int>(500, 600, 1);
+        auto q = random_polynomial<int>(400, 500, 2);
+        REQUIRE( multiply(p, q, 4) == p*q );
+    }
+    SECTION( "dense double" ) {
+        auto p = random_polynomial<double>(500, 600, 3);
+        auto q = random_polynomial<double>(400, 500, 4);
+        REQUIRE( multiply(p, q, 3) == p*q );
+    }
+    SECTION( "sparse" ) {
+        auto p = random_polynomial<long long>(200, 1000000, 5);
+        auto q = random_polynomial<long long>(200, 1000000, 6);
+        REQUIRE( multiply(p, q, 4) == p*q );
+    }
+    SECTION( "small operands" ) {
+        Polynomial<int> r( {{0,1},{1,-1}} );
+        REQUIRE( multiply(r, r, 8) == r*r );
+    }
+}
+
+TEST_CASE( "Thread pool runs every task" ) {
+    ThreadPool pool(4);
+    std::vector<int> hits(10000, 0);
+    pool.parallel_for(hits.size(), [&](size_t i) { hits[i]++; });
+    REQUIRE( std::count(hits.begin(), hits.end(), 1) == 10000 );
+
+    // Nested parallel loops are run by the calling worker if needed
+    std::atomic<int> total(0);
+    pool.parallel_for(8, [&](size_t) {
+        pool.parallel_for(100, [&](size_t) { total++; });
+    });
+    REQUIRE( total == 800 );
+
+    REQUIRE_THROWS_AS( pool.parallel_for(10, [](size_t i) {
+        if (i == 5) throw std::runtime_error("task failed");
+    }), std::runtime_error );
+
+    // Teams run many loops on the same helpers
+    for (int variant = 0; variant < 2; ++variant) {
+        std::unique_ptr<detail::WorkerTeam> team(variant == 0 ? new detail::WorkerTeam(3)
+                                                              : new detail::WorkerTeam(pool));
+        std::vector<int> counts(500, 0);
+        auto increment = [&](size_t i) { counts[i]++; };
+        for (int loop = 0; loop < 200; ++loop)
+            team->run(counts.size(), increment);
+        REQUIRE( std::count(counts.begin(), counts.end(), 200) == 500 );
+    }
+}
+
+TEST_CASE( "Multiplication on a thread pool" ) {
+    ThreadPool pool(3);
+    auto p = random_polynomial<int>(500, 600, 8);
+    auto q = random_polynomial<int>(400, 500, 9);
+    REQUIRE( multiply(p, q, pool) == p*q );
+}
+
+TEST_CASE( "Batch operations" ) {
+    ThreadPool pool(4);
+    std::vector<Polynomial<int>> lhs, rhs;
+    std::vector<int> points;
+    for (unsigned i = 0; i < 200; ++i) {
+        lhs.push_back(random_polynomial<int>(5, 10, i));
+        rhs.push_back(random_polynomial<int>(5, 10, 1000 + i));
+        points.push_back(int(i % 7) - 3);
+    }
+
+    auto products = multiply_batch(lhs, rhs, pool);
+    auto values = evaluate_batch(lhs, points, pool);
+    auto derivatives = differentiate_batch(lhs, pool);
+
+    REQUIRE( products.size() == lhs.size() );
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        REQUIRE( products[i] == lhs[i] * rhs[i] );
+        REQUIRE( values[i] == lhs[i](points[i]) );
+        REQUIRE( derivatives[i] == lhs[i].differentiate() );
+    }
+
+    REQUIRE_THROWS_AS( multiply_batch(lhs, std::vector<Polynomial<int>>(), pool),
+                       std::invalid_argument );
+}
+
+// Memory resource that counts allocations passed on to the default resource
+struct CountingResource : std::pmr::memory_resource {
+    size_t allocations = 0;
+
+    void *do_allocate(size_t bytes, size_t alignment) override {
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+TEST_CASE( "Polynomials allocate from the scoped memory resource" ) {
+    CountingResource counter;
+    auto x = Polynomial<float>::LinearTerm();
+    {
+        PolynomialResourceScope scope(&counter);
+        auto g = 4.5*x*x - 7.1*x + 0.5;
+        REQUIRE( g.get_allocator().resource() == &counter );
+    }
+    REQUIRE( counter.allocations > 0 );
+    REQUIRE( x.get_allocator().resource() == polynomial_default_resource() );
+
+    // Explicit allocators take precedence over the scope
+    Polynomial<float> y(x, Polynomial<float>::allocator_type(&counter));
+    REQUIRE( y.get_allocator().resource() == &counter );
+    REQUIRE( y == x );
+}
+
+TEST_CASE( "Arena and pool allocation" ) {
+    auto x = Polynomial<double>::LinearTerm();
+    Polynomial<double> kept;
+    {
+        PolynomialArena arena;
+        auto g = 4.5*x*x - 7.1*x + 0.5;
+        REQUIRE( g.get_allocator().resource() == arena.get() );
+
+        // Assignment copies the terms out of the arena
+        kept = g;
+    }
+    REQUIRE( kept.get_allocator().resource() == polynomial_default_resource() );
+    REQUIRE( kept == Polynomial<double>({{0,0.5},{1,-7.1},{2,4.5}}) );
+
+    {
+        PolynomialPoolScope scope;
+        auto p = random_polynomial<int>(50, 100, 10);
+        auto q = p * p + p;
+        REQUIRE( q.get_allocator().resource() == thread_polynomial_pool() );
+        REQUIRE( q.length() > 0 );
+    }
+
+    // Batch results allocate from the caller's resource, not the pool's,
+    // so they may outlive the pool
+    PolynomialArena arena;
+    std::vector<Polynomial<double>> ps(10, x), derivatives, products;
+    {
+        ThreadPool pool(2);
+        REQUIRE( pool.worker_resource() == pool.worker_resource() );
+        derivatives = differentiate_batch(ps, pool);
+        products = multiply_batch(ps, ps, pool);
+    }
+    for (auto &d : derivatives) {
+        REQUIRE( d.get_allocator().resource() == arena.get() );
+        REQUIRE( d == Polynomial<double>(1.0) );
+    }
+    for (auto &p : products) {
+        REQUIRE( p.get_allocator().resource() == arena.get() );
+        REQUIRE( p == x * x );
+    }
+}
+
+TEST_CASE( "Compound assignment" ) {
+    Polynomial<int> p( {{0,1},{1,1}} );
+    Polynomial<int> q( {{1,1},{2,1}} );
+
+    Polynomial<int> sum = p;
+    sum += q;
+    REQUIRE( sum == p + q );
+
+    Polynomial<int> difference = p;
+    difference -= q;
+    REQUIRE( difference == p - q );
+
+    Polynomial<int> product = p;
+    product *= q;
+    REQUIRE( product == p * q );
+
+    product *= 0;
+    REQUIRE( product == Polynomial<int>() );
+
+    Polynomial<int> axpy = p;
+    axpy.add_scaled(-3, q);
+    REQUIRE( axpy == p - 3*q );
+
+    // The operand may be the polynomial itself
+    auto r = random_polynomial<int>(30, 60, 16);
+    const auto r_copy = r;
+    r -= r;
+    REQUIRE( r.length() == 0 );
+    r = r_copy;
+    r.add_scaled(-1, r);
+    REQUIRE( r.length() == 0 );
+    r = r_copy;
+    r.add_scaled(2, r);
+    REQUIRE( r == 3*r_copy );
+    Polynomial<int> with_zero(0);
+    with_zero.add_term(1, 2);
+    with_zero += with_zero;
+    REQUIRE( with_zero == Polynomial<int>(std::map<unsigned,int>({{1,4}})) );
+}
+
+TEST_CASE( "Temporaries are reused without changing named operands" ) {
+    auto p = random_polynomial<int>(40, 100, 11);
+    auto q = random_polynomial<int>(40, 100, 12);
+    const auto p_copy = p, q_copy = q;
+
+    REQUIRE( (p + q) + (q - p) == 2*q_copy );
+    REQUIRE( (p - q) - (p + q) == -2*q_copy );
+    REQUIRE( p - (q * 3) == p_copy - 3*q_copy );
+    REQUIRE( 5 * (p * q) * 2 == 10 * (p_copy * q_copy) );
+    REQUIRE( -(p + q) == -p_copy - q_copy );
+    REQUIRE( p == p_copy );
+    REQUIRE( q == q_copy );
+
+    // Adding a term to a temporary only allocates the new node
+    CountingResource counter;
+    PolynomialResourceScope scope(&counter);
+    Polynomial<int> big = random_polynomial<int>(100, 100, 13);
+    Polynomial<int> term( std::map<unsigned,int>({{1000,1}}) );
+    size_t before = counter.allocations;
+    auto result = std::move(big) + term;
+    REQUIRE( counter.allocations - before == 1 );
+    REQUIRE( result.length() == 101 );
+}
+
+TEST_CASE( "Compile-time polynomials" ) {
+    // 2x^2 - 3x + 1
+    constexpr auto p = make_static_polynomial(1, -3, 2);
+    constexpr auto x = make_static_polynomial(0, 1);
+
+    static_assert( p(0) == 1, "constexpr evaluation" );
+    static_assert( p(2) == 3, "constexpr evaluation" );
+    static_assert( p.differentiate() == make_static_polynomial(-3, 4), "constexpr derivative" );
+    static_assert( 2*x*x - 3*x + 1 == p, "constexpr arithmetic" );
+    static_assert( (p * x).degree() == 3, "constexpr product" );
+    static_assert( (p - p).degree() == 0, "constexpr difference" );
+    static_assert( decltype(p * p)::size() == 5, "product size" );
+
+    for (int i = -10; i <= 10; ++i)
+        REQUIRE( p(i) == 2*i*i - 3*i + 1 );
+
+    constexpr auto q = make_static_polynomial(0.5, -7.1, 4.5);
+    REQUIRE( q.evaluate_fma(3.0) == Approx(q(3.0)) );
+}
+
+TEST_CASE( "Conversion between static and runtime polynomials" ) {
+    constexpr auto p = make_static_polynomial(-7, 3, 5);
+    Polynomial<int> runtime = p.to_polynomial();
+    REQUIRE( runtime == Polynomial<int>({{0,-7},{1,3},{2,5}}) );
+    REQUIRE( StaticPolynomial<int, 4>(runtime) == p );
+    REQUIRE_THROWS_AS( (StaticPolynomial<int, 2>(runtime)), std::length_error );
+
+    std::stringstream ss;
+    ss << p;
+    REQUIRE( ss.str() == "5x^2 + 3x - 7" );
+}
+
+TEST_CASE( "Allocation tracking" ) {
+    auto p = random_polynomial<int>(20, 40, 16);
+    AllocationStats before = thread_allocation_stats();
+
+    std::unique_ptr<Polynomial<int>> escaped;
+    {
+        AllocationTrackingScope outer;
+        {
+            AllocationTrackingScope inner;
+            auto q = p + 1;
+            REQUIRE( q.get_allocator().resource() == polynomial_tracking_resource() );
+            REQUIRE( inner.stats().allocations >= q.length() );
+            REQUIRE( inner.stats().live_bytes > 0 );
+
+            // Moved-to polynomials keep the tracking resource
+            escaped.reset(new Polynomial<int>(std::move(q)));
+        }
+        REQUIRE( outer.stats().allocations >= escaped->length() );
+        REQUIRE( outer.stats().peak_bytes >= outer.stats().live_bytes );
+
+        auto r = p * p;
+        REQUIRE( outer.stats().allocations >= escaped->length() + r.length() );
+    }
+
+    AllocationStats after = thread_allocation_stats();
+    REQUIRE( after.allocations > before.allocations );
+    REQUIRE( after.live_bytes > before.live_bytes );
+
+    // Blocks allocated in a scope can be released after it has closed
+    escaped.reset();
+    REQUIRE( thread_allocation_stats().live_bytes == before.live_bytes );
+
+    // Tracking composes with an enclosing arena
+    PolynomialArena arena;
+    AllocationTrackingScope tracked;
+    auto s = p * 2;
+
+    // One more allocation for the constant 2 converted to a polynomial
+    REQUIRE( tracked.stats().allocations == s.length() + 1 );
+}
+
+TEST_CASE( "Binary serialization round trip" ) {
+    SECTION( "dense" ) {
+        auto p = random_polynomial<double>(200, 250, 17);
+        std::vector<char> buffer;
+        write_binary(p, buffer);
+        REQUIRE( buffer.size() == binary_size(p) );
+
+        PolynomialView<double> view(buffer.data(), buffer.size());
+        REQUIRE( view.encoding() == ExponentEncoding::Delta8 );
+        REQUIRE( view.length() == p.length() );
+        REQUIRE( view.degree() == p.degree() );
+        REQUIRE( view == p );
+        REQUIRE( view.to_polynomial() == p );
+        REQUIRE( view.differentiate() == p.differentiate() );
+        REQUIRE( view(0.75) == p(0.75) );
+        for (unsigned e = 0; e < 260; ++e)
+            REQUIRE( view.coefficient(e) == p.coefficient(e) );
+    }
+    SECTION( "sparse" ) {
+        Polynomial<int> p( {{10,1},{400,-2},{5000,3}} );
+        auto q = random_polynomial<int>(50, 4000000, 19);
+
+        // Records can be concatenated
+        std::vector<char> buffer;
+        write_binary(p, buffer);
+        write_binary(q, buffer);
+
+        PolynomialView<int> first(buffer.data(), buffer.size());
+        PolynomialView<int> second(buffer.data() + first.size_bytes(),
+                                   buffer.size() - first.size_bytes());
+        REQUIRE( first.encoding() == ExponentEncoding::Delta16 );
+        REQUIRE( second.encoding() == ExponentEncoding::Absolute32 );
+        REQUIRE( first == p );
+        REQUIRE( second == q );
+        for (auto &term : q)
+            REQUIRE( second.coefficient(term.first) == term.second );
+        REQUIRE( second.coefficient(4000001) == 0 );
+    }
+    SECTION( "complex and zero" ) {
+        Polynomial<std::complex<float>> h({{0,{1,-1}}, {1,{-2,1}}});
+        std::stringstream ss;
+        write_binary(h, ss);
+        std::string bytes = ss.str();
+        REQUIRE( read_binary<std::complex<float>>(bytes.data(), bytes.size()) == h );
+
+        std::vector<char> buffer;
+        write_binary(Polynomial<float>(), buffer);
+        REQUIRE( read_binary<float>(buffer.data(), buffer.size()) == Polynomial<float>() );
+    }
+}
+
+TEST_CASE( "Binary format validation" ) {
+    std::vector<char> buffer;
+    write_binary(Polynomial<int>({{0,1},{5,2}}), buffer);
+
+    REQUIRE_THROWS_AS( PolynomialView<int>(buffer.data(), 10), BinaryFormatError );
+    REQUIRE_THROWS_AS( PolynomialView<int>(buffer.data(), buffer.size() - 8), BinaryFormatError );
+    REQUIRE_THROWS_AS( PolynomialView<float>(buffer.data(), buffer.size()), BinaryFormatError );
+    REQUIRE_THROWS_AS( PolynomialView<long long>(buffer.data(), buffer.size()), BinaryFormatError );
+
+    buffer[0] = 'X';
+    REQUIRE_THROWS_AS( PolynomialView<int>(buffer.data(), buffer.size()), BinaryFormatError );
+
+    // Exponents out of order, repeated, or not ending at the degree
+    std::vector<char> sparse;
+    write_binary(Polynomial<int>({{10,1},{100000,2},{200000,3}}), sparse);
+    REQUIRE( PolynomialView<int>(sparse.data(), sparse.size()).encoding() == ExponentEncoding::Absolute32 );
+    auto set_exponent = [&](size_t i, uint32_t exponent) {
+        std::memcpy(sparse.data() + sizeof(BinaryHeader) + 4 * i, &exponent, 4);
+    };
+    set_exponent(1, 300000);
+    REQUIRE_THROWS_AS( PolynomialView<int>(sparse.data(), sparse.size()), BinaryFormatError );
+    set_exponent(1, 10);
+    REQUIRE_THROWS_AS( PolynomialView<int>(sparse.data(), sparse.size()), BinaryFormatError );
+    set_exponent(1, 100000);
+    set_exponent(2, 150000);
+    REQUIRE_THROWS_AS( PolynomialView<int>(sparse.data(), sparse.size()), BinaryFormatError );
+
+    std::vector<char> dense;
+    write_binary(Polynomial<int>({{0,1},{1,2},{2,3}}), dense);
+    dense[sizeof(BinaryHeader) + 1] = 0;
+    REQUIRE_THROWS_AS( read_binary<int>(dense.data(), dense.size()), BinaryFormatError );
+}
+
+TEST_CASE( "Memory-mapped polynomial store" ) {
+    std::string path = (std::filesystem::temp_directory_path() / "polynomial_store_test.bin").string();
+
+    std::vector<Polynomial<double>> polynomials;
+    for (unsigned i = 0; i < 100; ++i)
+        polynomials.push_back(random_polynomial<double>(i % 20, 1 + i * 100, i));
+    {
+        PolynomialStoreWriter<double> writer(path);
+        for (auto &p : polynomials)
+            REQUIRE( writer.add(p) == size_t(&p - &polynomials[0]) );
+    }
+
+    PolynomialStore<double> store(path);
+    REQUIRE( store.size() == polynomials.size() );
+    for (size_t id : {99, 0, 57, 3}) {
+        REQUIRE( store[id] == polynomials[id] );
+        REQUIRE( store[id](0.5) == polynomials[id](0.5) );
+    }
+    REQUIRE_THROWS_AS( store.at(100), std::out_of_range );
+
+    // Stores are typed
+    REQUIRE_THROWS_AS( PolynomialStore<int>(path)[1], BinaryFormatError );
+    REQUIRE_THROWS_AS( PolynomialStore<double>(path + ".missing"), std::system_error );
+
+    PolynomialStore<double> moved(std::move(store));
+    REQUIRE( moved.at(42).to_polynomial() == polynomials[42] );
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE( "Parsing printed polynomials" ) {
+    REQUIRE( parse<int>("5x^2 + 3x - 7") == Polynomial<int>({{0,-7},{1,3},{2,5}}) );
+    REQUIRE( parse<int>("-5") == Polynomial<int>(-5) );
+    REQUIRE( parse<int>("0") == Polynomial<int>() );
+    REQUIRE( parse<int>("5y^2 + 3y - 7", "y") == parse<int>("5x^2 + 3x - 7") );
+    REQUIRE( parse<float>("0.22x^2 - 1.5x + 3.3") == Polynomial<float>({{0,3.3},{1,-1.5},{2,0.22}}) );
+
+    // Forms not written by print()
+    REQUIRE( parse<int>("x^2 - x") == Polynomial<int>({{1,-1},{2,1}}) );
+    REQUIRE( parse<int>("-x + 2*x^3 + x^3") == Polynomial<int>({{1,-1},{3,3}}) );
+    REQUIRE( parse<int>(" 1 +\t2x\n") == Polynomial<int>({{0,1},{1,2}}) );
+    REQUIRE( parse<double>("2.5t^10 - 1e-3", "t") == Polynomial<double>({{0,-1e-3},{10,2.5}}) );
+
+    // Round trips through print()
+    auto check_round_trip = [](auto p, std::string variable) {
+        std::stringstream ss;
+        p.print(ss, variable);
+        REQUIRE( parse<typename decltype(p.begin())::value_type::second_type>(ss.str(), variable) == p );
+    };
+    check_round_trip(random_polynomial<int>(100, 200, 20), "x");
+    check_round_trip(random_polynomial<long long>(100, 100000, 21), "var");
+    check_round_trip(Polynomial<double>({{0,-0.125},{3,1024.5},{7,-3}}), "x");
+    check_round_trip(Polynomial<std::complex<float>>({{0,{1,-1}}, {1,{-2,1}}}), "z");
+}
+
+TEST_CASE( "Parse errors report positions" ) {
+    auto position_of = [](std::string_view text) {
+        try {
+            parse<int>(text);
+        } catch (const ParseError &e) {
+            return e.position();
+        }
+        return size_t(-1);
+    };
+
+    REQUIRE( position_of("") == 0 );
+    REQUIRE( position_of("5x^2 + ") == 7 );
+    REQUIRE( position_of("5x^2 3x") == 5 );
+    REQUIRE( position_of("5x^ + 1") == 3 );
+    REQUIRE( position_of("5y") == 1 );
+    REQUIRE( position_of("1.5x") == 1 );
+    REQUIRE_THROWS_AS( parse<std::complex<double>>("(1,2x"), ParseError );
+}
+
+TEST_CASE( "Formatting matches print()" ) {
+    auto check = [](auto p, std::string variable, unsigned cached_exponents) {
+        typedef typename decltype(p.begin())::value_type::second_type T;
+        std::stringstream ss;
+        p.print(ss, variable);
+
+        PolynomialFormatter<T> formatter(variable, cached_exponents);
+        REQUIRE( formatter.to_string(p) == ss.str() );
+
+        std::string out = "prefix ";
+        formatter.append(out, p);
+        REQUIRE( out == "prefix " + ss.str() );
+    };
+
+    for (unsigned cached : {0, 4, 256}) {
+        check(Polynomial<int>(), "x", cached);
+        check(Polynomial<int>({{0,-7},{1,3},{2,5}}), "x", cached);
+        check(Polynomial<int>( std::map<unsigned,int>({{1,-2}}) ), "y", cached);
+        check(random_polynomial<int>(100, 1000, 22), "x", cached);
+        check(random_polynomial<float>(100, 1000, 23), "x", cached);
+        check(random_polynomial<double>(100, 4000000, 24), "var", cached);
+        check(Polynomial<double>({{0,1e-300},{3,-1234567.0},{5,0.1}}), "x", cached);
+        check(Polynomial<std::complex<float>>({{0,{1,-1}}, {1,{-2,1.5}}}), "z", cached);
+        check(Polynomial<int>({{0,1},{std::numeric_limits<unsigned>::max(),2}}), "x", cached);
+    }
+
+    REQUIRE( to_string(Polynomial<int>({{0,-7},{1,3},{2,5}}), "t") == "5t^2 + 3t - 7" );
+}
+
+TEST_CASE( "Formatting into a fixed buffer" ) {
+    Polynomial<int> p({{0,-7},{1,3},{2,5}});
+    PolynomialFormatter<int> formatter;
+    char buffer[32];
+
+    auto result = formatter.format(buffer, buffer + sizeof(buffer), p);
+    REQUIRE( result.ec == std::errc() );
+    REQUIRE( std::string(buffer, result.ptr) == "5x^2 + 3x - 7" );
+
+    for (size_t size = 0; size < 13; ++size)
+        REQUIRE( formatter.format(buffer, buffer + size, p).ec == std::errc::value_too_large );
+    REQUIRE( formatter.format(buffer, buffer + 13, p).ec == std::errc() );
+
+    // The largest exponent is past every cached suffix
+    Polynomial<int> high({{0,1},{std::numeric_limits<unsigned>::max(),2}});
+    result = formatter.format(buffer, buffer + sizeof(buffer), high);
+    REQUIRE( result.ec == std::errc() );
+    REQUIRE( std::string(buffer, result.ptr) == "2x^4294967295 + 1" );
+}
+
+// Write p to a temporary coefficient stream, rewound for reading
+template<typename T>
+std::FILE *stream_of(const Polynomial<T> &p, size_t chunk_terms) {
+    std::FILE *file = std::tmpfile();
+    CoefficientWriter<T>(file, chunk_terms).write(p);
+    std::rewind(file);
+    return file;
+}
+
+TEST_CASE( "Coefficient streams" ) {
+    auto p = random_polynomial<double>(1000, 5000, 25);
+    std::FILE *file = stream_of(p, 64);
+
+    CoefficientReader<double> reader(file);
+    TermChunk<double> chunk;
+    REQUIRE( reader.next_chunk(chunk) );
+    REQUIRE( chunk.size() == 64 );
+    REQUIRE( chunk.exponents[0] == p.begin()->first );
+
+    std::rewind(file);
+    REQUIRE( CoefficientReader<double>(file).read_all() == p );
+
+    std::rewind(file);
+    REQUIRE_THROWS_AS( CoefficientReader<float>(file), BinaryFormatError );
+    std::fclose(file);
+
+    // Exponents must be written in order
+    std::FILE *out = std::tmpfile();
+    CoefficientWriter<int> writer(out);
+    writer.write(5, 1);
+    REQUIRE_THROWS_AS( writer.write(5, 1), std::invalid_argument );
+    writer.close();
+
+    // Truncated streams are detected
+    std::rewind(out);
+    std::string bytes(100, '\0');
+    bytes.resize(std::fread(&bytes[0], 1, bytes.size(), out));
+    std::fclose(out);
+    std::FILE *truncated = std::tmpfile();
+    std::fwrite(bytes.data(), 1, bytes.size() - 2, truncated);
+    std::rewind(truncated);
+    CoefficientReader<int> truncated_reader(truncated);
+    REQUIRE_THROWS_AS( truncated_reader.read_all(), BinaryFormatError );
+    std::fclose(truncated);
+
+    // Corrupt chunk counts and unordered exponents are rejected
+    auto corrupt = [&](size_t offset, uint32_t value) {
+        std::string copy = bytes;
+        std::memcpy(&copy[offset], &value, sizeof(value));
+        std::FILE *file = std::tmpfile();
+        std::fwrite(copy.data(), 1, copy.size(), file);
+        std::rewind(file);
+        CoefficientReader<int> reader(file);
+        REQUIRE_THROWS_AS( reader.read_all(), BinaryFormatError );
+        std::fclose(file);
+    };
+    corrupt(sizeof(StreamHeader), 0xffffffff);
+    corrupt(sizeof(StreamHeader), 2);
+
+    std::FILE *unordered = std::tmpfile();
+    {
+        CoefficientWriter<int> two_chunks(unordered, 1);
+        two_chunks.write(7, 1);
+        two_chunks.write(9, 1);
+    }
+    std::rewind(unordered);
+    bytes.assign(100, '\0');
+    bytes.resize(std::fread(&bytes[0], 1, bytes.size(), unordered));
+    std::fclose(unordered);
+    // Second chunk: count, exponent 9 -> 7
+    corrupt(sizeof(StreamHeader) + 12 + 4, 7);
+}
+
+TEST_CASE( "Out-of-core addition and differentiation" ) {
+    auto p = random_polynomial<int>(3000, 10000, 26);
+    auto q = random_polynomial<int>(2000, 10000, 27);
+
+    auto check_sum = [](const Polynomial<int> &lhs, const Polynomial<int> &rhs) {
+        std::FILE *a = stream_of(lhs, 100), *b = stream_of(rhs, 37), *sum = std::tmpfile();
+        {
+            CoefficientReader<int> reader_a(a), reader_b(b);
+            CoefficientWriter<int> writer(sum, 50);
+            stream_add(reader_a, reader_b, writer);
+        }
+        std::rewind(sum);
+        REQUIRE( CoefficientReader<int>(sum).read_all() == lhs + rhs );
+        std::fclose(a);
+        std::fclose(b);
+        std::fclose(sum);
+    };
+    check_sum(p, q);
+    check_sum(p, -p);
+    check_sum(p, Polynomial<int>());
+
+    std::FILE *in = stream_of(p, 128), *out = std::tmpfile();
+    {
+        CoefficientReader<int> reader(in);
+        CoefficientWriter<int> writer(out, 100);
+        stream_differentiate(reader, writer);
+    }
+    std::rewind(out);
+    REQUIRE( CoefficientReader<int>(out).read_all() == p.differentiate() );
+    std::fclose(in);
+    std::fclose(out);
+}
+
+TEST_CASE( "Out-of-core multiplication" ) {
+    std::string rhs_path = (std::filesystem::temp_directory_path() / "polynomial_stream_rhs.bin").string();
+
+    auto check_product = [&](const Polynomial<int> &p, const Polynomial<int> &q, size_t budget) {
+        {
+            CoefficientWriter<int> writer(rhs_path, 50);
+            writer.write(q);
+        }
+        std::FILE *lhs = stream_of(p, 64), *product = std::tmpfile();
+        {
+            CoefficientReader<int> reader(lhs);
+            CoefficientWriter<int> writer(product);
+            stream_multiply(reader, rhs_path, writer, budget);
+        }
+        std::rewind(product);
+        REQUIRE( CoefficientReader<int>(product).read_all() == p*q );
+        std::fclose(lhs);
+        std::fclose(product);
+    };
+
+    SECTION( "sparse" ) {
+        auto p = random_polynomial<int>(1000, 100000, 28);
+        auto q = random_polynomial<int>(700, 100000, 29);
+        check_product(p, q, 3200);
+        check_product(p, q, 1 << 20);
+    }
+    SECTION( "sparse with a bounded accumulator" ) {
+        // Far more distinct product terms than the budget holds
+        auto p = random_polynomial<int>(40, 1000000, 33);
+        auto q = random_polynomial<int>(2000, 1000000, 34);
+        const size_t budget = 16 << 10;
+        REQUIRE( (p*q).length() > 10 * budget / sizeof(int) );
+        check_product(p, q, budget);
+
+        // Only the accumulator allocates through the polynomial resource
+        std::FILE *lhs = stream_of(p, 64), *product = std::tmpfile();
+        CoefficientReader<int> reader(lhs);
+        CoefficientWriter<int> writer(product);
+        AllocationTrackingScope tracking;
+        stream_multiply(reader, rhs_path, writer, budget);
+        REQUIRE( tracking.stats().peak_bytes > 0 );
+        REQUIRE( tracking.stats().peak_bytes <= (long long)budget / 2 );
+        writer.close();
+        std::fclose(lhs);
+        std::fclose(product);
+    }
+    SECTION( "dense" ) {
+        auto p = random_polynomial<int>(500, 600, 30);
+        auto q = random_polynomial<int>(400, 500, 31);
+        check_product(p, q, 3200);
+        check_product(q, p, 100);
+    }
+    SECTION( "empty operand" ) {
+        auto p = random_polynomial<int>(100, 1000, 32);
+        check_product(p, Polynomial<int>(), 3200);
+        check_product(Polynomial<int>(), p, 3200);
+    }
+    SECTION( "budget too small" ) {
+        check_product(Polynomial<int>(), Polynomial<int>(), 1 << 10);
+        std::FILE *lhs = stream_of(Polynomial<int>(), 64), *product = std::tmpfile();
+        CoefficientReader<int> reader(lhs);
+        CoefficientWriter<int> writer(product);
+        REQUIRE_THROWS_AS( stream_multiply(reader, rhs_path, writer, 4), std::invalid_argument );
+        writer.close();
+        std::fclose(lhs);
+        std::fclose(product);
+    }
+
+    std::filesystem::remove(rhs_path);
+}
+
+TEST_CASE( "Real roots" ) {
+    Polynomial<int> x(std::map<unsigned,int>({{1,1}}));
+    auto linear = [&](int a, int b) { return x*a - Polynomial<int>(b); };
+
+    SECTION( "integer roots are exact" ) {
+        REQUIRE( real_roots(linear(1, 1) * linear(1, 2) * linear(1, -3)) == std::vector<double>({-3, 1, 2}) );
+
+        Polynomial<int> w(1);
+        for (int i = 1; i <= 10; ++i)
+            w *= linear(1, i);
+        REQUIRE( real_roots(w) == std::vector<double>({1, 2, 3, 4, 5, 6, 7, 8, 9, 10}) );
+        REQUIRE( real_roots(x*x*x + x) == std::vector<double>({0}) );
+        REQUIRE( real_roots(x*x + Polynomial<int>(1)).empty() );
+        REQUIRE( real_roots(Polynomial<int>(std::map<unsigned,int>({{100,1},{0,-1}}))) == std::vector<double>({-1, 1}) );
+    }
+    SECTION( "irrational and close roots" ) {
+        auto roots = real_roots(x*x - Polynomial<int>(2));
+        REQUIRE( roots.size() == 2 );
+        REQUIRE( roots[0] == Approx(-std::sqrt(2.0)).margin(1e-12) );
+        REQUIRE( roots[1] == Approx(std::sqrt(2.0)).margin(1e-12) );
+
+        roots = real_roots(x*x - Polynomial<int>(2), 1e-3);
+        REQUIRE( std::abs(roots[1] - std::sqrt(2.0)) <= 1e-3 );
+
+        roots = real_roots(linear(1000000, 1000001) * linear(1, 1));
+        REQUIRE( roots.size() == 2 );
+        REQUIRE( roots[0] == Approx(1.0).margin(1e-12) );
+        REQUIRE( roots[1] == Approx(1.000001).margin(1e-12) );
+    }
+    SECTION( "multiple roots are reported once" ) {
+        auto p = linear(3, 1) * linear(3, 1) * linear(1, 5);
+        auto roots = real_roots(p);
+        REQUIRE( roots.size() == 2 );
+        REQUIRE( roots[0] == Approx(1.0 / 3).margin(1e-12) );
+        REQUIRE( roots[1] == 5 );
+
+        auto q = linear(1, 1) * linear(1, 1) * linear(1, 1) * linear(1, -2) * linear(1, -2);
+        REQUIRE( real_roots(q) == std::vector<double>({-2, 1}) );
+    }
+    SECTION( "random products of linear factors" ) {
+        std::mt19937 rng(33);
+        std::uniform_int_distribution<int> root(-50, 50);
+        for (int trial = 0; trial < 20; ++trial) {
+            Polynomial<long long> p(1);
+            std::vector<double> expected;
+            for (int i = 0; i < 6; ++i) {
+                int r = root(rng);
+                p *= Polynomial<long long>(std::map<unsigned,long long>({{1,1},{0,-r}}));
+                expected.push_back(r);
+            }
+            std::sort(expected.begin(), expected.end());
+            expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+            REQUIRE( real_roots(p) == expected );
+        }
+    }
+    SECTION( "floating point coefficients" ) {
+        Polynomial<double> p(std::map<unsigned,double>({{2,1.0},{0,-0.5}}));
+        auto roots = real_roots(p);
+        REQUIRE( roots.size() == 2 );
+        REQUIRE( roots[0] == Approx(-std::sqrt(0.5)).margin(1e-12) );
+        REQUIRE( roots[1] == Approx(std::sqrt(0.5)).margin(1e-12) );
+
+        Polynomial<float> f(std::map<unsigned,float>({{3,1.0f},{1,-2.0f},{0,1.0f}}));
+        REQUIRE( real_roots(f).size() == 3 );
+
+        // Scaling by the root bound must not overflow for high degrees
+        Polynomial<double> high(std::map<unsigned,double>({{200,1.0},{0,-1e30}}));
+        roots = real_roots(high);
+        REQUIRE( roots.size() == 2 );
+        REQUIRE( roots[0] == Approx(-std::pow(1e30, 1.0 / 200)).epsilon(1e-12) );
+        REQUIRE( roots[1] == Approx(std::pow(1e30, 1.0 / 200)).epsilon(1e-12) );
+        Polynomial<double> steep(std::map<unsigned,double>({{3000,1.0},{1,-1e300}}));
+        roots = real_roots(steep);
+        REQUIRE( roots.size() == 2 );
+        REQUIRE( roots[0] == 0 );
+        REQUIRE( roots[1] == Approx(std::pow(1e300, 1.0 / 2999)).epsilon(1e-12) );
+    }
+    SECTION( "invalid arguments" ) {
+        REQUIRE_THROWS_AS( real_roots(Polynomial<int>()), std::invalid_argument );
+        REQUIRE_THROWS_AS( real_roots(Polynomial<int>(0)), std::invalid_argument );
+        REQUIRE_THROWS_AS( real_roots(x, 0), std::invalid_argument );
+    }
+}
+
+TEST_CASE( "Complex roots" ) {
+    typedef std::complex<double> C;
+    Polynomial<int> x(std::map<unsigned,int>({{1,1}}));
+
+    // Whether every expected root has a distinct root within tolerance
+    auto matches = [](std::vector<C> roots, const std::vector<C> &expected, double tolerance) {
+        if (roots.size() != expected.size())
+            return false;
+        for (auto &z : expected) {
+            auto closest = std::min_element(roots.begin(), roots.end(), [&](C a, C b) {
+                return std::abs(a - z) < std::abs(b - z);
+            });
+            if (std::abs(*closest - z) > tolerance)
+                return false;
+            roots.erase(closest);
+        }
+        return true;
+    };
+
+    SECTION( "small polynomials" ) {
+        auto p = x * (x - Polynomial<int>(1)) * (x - Polynomial<int>(2)) * (x*x + Polynomial<int>(1));
+        REQUIRE( matches(complex_roots(p), {0, 1, 2, C(0, 1), C(0, -1)}, 1e-12) );
+
+        auto q = (x - Polynomial<int>(1)) * (x - Polynomial<int>(1));
+        REQUIRE( matches(complex_roots(q), {1, 1}, 1e-7) );
+
+        REQUIRE( complex_roots(Polynomial<int>(3)).empty() );
+        REQUIRE_THROWS_AS( complex_roots(Polynomial<int>()), std::invalid_argument );
+    }
+    SECTION( "roots of unity" ) {
+        const double pi = std::acos(-1.0);
+        std::vector<C> expected;
+        for (int k = 0; k < 100; ++k)
+            expected.push_back(std::polar(1.0, 2 * pi * k / 100));
+        Polynomial<std::complex<float>> p(std::map<unsigned,std::complex<float>>({{100,1},{0,-1}}));
+        REQUIRE( matches(complex_roots(p), expected, 1e-12) );
+    }
+    SECTION( "random coefficients, independent of the thread count" ) {
+        std::mt19937 rng(34);
+        std::normal_distribution<double> normal;
+        Polynomial<double> p;
+        for (unsigned i = 0; i <= 300; ++i)
+            p.add_term(i, normal(rng));
+
+        auto roots = complex_roots(p, 1);
+        REQUIRE( roots.size() == 300 );
+        for (auto &z : roots) {
+            // Residual relative to the magnitude of the terms, evaluated
+            // in the reversed polynomial outside the unit circle
+            bool outside = std::abs(z) > 1;
+            C w = outside ? 1.0 / z : z, value = 0;
+            double scale = 0;
+            for (unsigned i = 0; i <= 300; ++i) {
+                double c = p.coefficient(outside ? i : 300 - i);
+                value = value * w + c;
+                scale = scale * std::abs(w) + std::abs(c);
+            }
+            REQUIRE( std::abs(value) <= 1e-12 * scale );
+        }
+
+        REQUIRE( complex_roots(p, 4) == roots );
+        ThreadPool pool(3);
+        REQUIRE( complex_roots(p, pool) == roots );
+
+        // Loops from other threads still get pool workers while a solve
+        // runs: each pair of tasks only meets once a worker runs one of them
+        std::atomic<bool> solving(true);
+        std::vector<C> concurrent;
+        std::thread solver([&]() {
+            concurrent = complex_roots(p, pool);
+            solving = false;
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        int met_while_solving = 0;
+        while (solving) {
+            std::atomic<int> arrived(0);
+            pool.parallel_for(2, [&](size_t) {
+                arrived++;
+                while (arrived < 2)
+                    std::this_thread::yield();
+            }, 1);
+            met_while_solving += solving;
+        }
+        solver.join();
+        REQUIRE( met_while_solving > 0 );
+        REQUIRE( concurrent == roots );
+    }
+}
+
+TEST_CASE( "Interval evaluation" ) {
+    SECTION( "enclosures are tight on narrow intervals" ) {
+        Polynomial<double> p(std::map<unsigned,double>({{2,1},{1,-2}}));
+        auto range = evaluate_interval(p, Interval<double>{0.9, 1.1});
+        REQUIRE( range.contains(-1) );
+        REQUIRE( range.contains(-0.99) );
+        REQUIRE( range.width() <= 0.041 );
+
+        // Monotone: the end points give the range
+        Polynomial<int> cube(std::map<unsigned,int>({{3,1}}));
+        range = evaluate_interval(cube, Interval<double>{1, 2});
+        REQUIRE( range.lower == Approx(1).margin(1e-12) );
+        REQUIRE( range.upper == Approx(8).margin(1e-12) );
+        REQUIRE( range.contains(1) );
+        REQUIRE( range.contains(8) );
+
+        range = evaluate_interval(Polynomial<int>(), Interval<double>{-1, 1});
+        REQUIRE( (range.lower == 0 && range.upper == 0) );
+    }
+    SECTION( "coefficients wider than the bounds are rounded outward" ) {
+        // 1 + 2^-60 and 1 - 2^-60 both round to 1 as doubles
+        long double tiny = std::ldexp(1.0L, -60);
+        for (long double c : {1 + tiny, 1 - tiny, -1 - tiny, -1 + tiny}) {
+            Polynomial<long double> constant(c), line(std::map<unsigned,long double>({{0,c},{1,c}}));
+            auto range = evaluate_interval(constant, Interval<double>{-1, 1});
+            REQUIRE( (long double)range.lower < c );
+            REQUIRE( c < (long double)range.upper );
+            range = evaluate_interval(line, Interval<double>{1, 1});
+            REQUIRE( (long double)range.lower <= 2 * c );
+            REQUIRE( 2 * c <= (long double)range.upper );
+        }
+    }
+    SECTION( "enclosures contain every value" ) {
+        // Integer coefficients and points keep the sampled values exact
+        auto p = random_polynomial<int>(8, 12, 36);
+        std::mt19937 rng(37);
+        std::uniform_int_distribution<int> end(-6, 6);
+        for (int trial = 0; trial < 200; ++trial) {
+            int a = end(rng), b = end(rng);
+            Interval<double> x{double(std::min(a, b)), double(std::max(a, b))};
+            auto range = evaluate_interval(p, x);
+            for (int i = std::min(a, b); i <= std::max(a, b); ++i)
+                REQUIRE( range.contains(double(p((long long)i))) );
+        }
+    }
+    SECTION( "batch matches single intervals" ) {
+        auto p = random_polynomial<double>(40, 100, 38);
+        std::vector<Interval<double>> x, batch(150);
+        for (int i = 0; i < 150; ++i)
+            x.push_back({-1 + i / 75.0, -1 + (i + 1) / 75.0});
+        evaluate_interval(p, x.data(), x.size(), batch.data());
+        for (size_t i = 0; i < x.size(); ++i) {
+            auto single = evaluate_interval(p, x[i]);
+            REQUIRE( batch[i].lower == single.lower );
+            REQUIRE( batch[i].upper == single.upper );
+            REQUIRE( batch[i].contains(p(x[i].lower + x[i].width() / 2)) );
+        }
+    }
+}
+
+TEST_CASE( "Compensated evaluation" ) {
+    // (x - 1)^7 expanded is ill-conditioned near 1
+    Polynomial<int> x(std::map<unsigned,int>({{1,1}}));
+    Polynomial<int> p(1);
+    for (int i = 0; i < 7; ++i)
+        p *= x - Polynomial<int>(1);
+
+    double point = 1 + std::ldexp(1.0, -10), exact = std::ldexp(1.0, -70);
+    auto result = evaluate_compensated_with_bound(p, point);
+    REQUIRE( std::abs(p(point) - exact) > 1e6 * exact );
+    REQUIRE( std::abs(result.value - exact) <= result.error_bound );
+    REQUIRE( std::abs(result.value - exact) <= 1e-6 * exact );
+    REQUIRE( evaluate_compensated(p, point) == result.value );
+
+    // The batch form, against (x - 1)^7 in long double where x - 1 is exact
+    std::vector<double> points, values(100), bounds(100);
+    for (int i = 0; i < 100; ++i)
+        points.push_back(point + std::ldexp(double(i), -30));
+    evaluate_compensated(p, points.data(), points.size(), values.data(), bounds.data());
+    for (size_t i = 0; i < points.size(); ++i) {
+        long double d = (long double)points[i] - 1;
+        double reference = double(d * d * d * d * d * d * d);
+        REQUIRE( std::abs(values[i] - reference) <= bounds[i] + 1e-15 * reference );
+        auto single = evaluate_compensated_with_bound(p, points[i]);
+        REQUIRE( std::abs(values[i] - single.value) <= bounds[i] + single.error_bound );
+    }
+
+    // Well-conditioned polynomials evaluate as usual
+    auto q = random_polynomial<double>(30, 60, 39);
+    REQUIRE( evaluate_compensated(q, 0.7) == Approx(q(0.7)) );
+    REQUIRE( evaluate_compensated(Polynomial<double>(), 0.7) == 0 );
+}
+
+TEST_CASE( "Chebyshev basis" ) {
+    // T_3 = 4x^3 - 3x
+    ChebyshevPolynomial<double> t3(std::vector<double>{0, 0, 0, 1});
+    REQUIRE( t3.to_polynomial() == Polynomial<double>({{1,-3},{3,4}}) );
+    REQUIRE( ChebyshevPolynomial<double>(Polynomial<double>({{1,-3},{3,4}})) == t3 );
+    REQUIRE( t3(0.5) == Approx(-1) );
+    REQUIRE( ChebyshevPolynomial<double>(0.0).length() == 0 );
+
+    std::ostringstream out;
+    out << ChebyshevPolynomial<double>(std::vector<double>{1, 0, -2});
+    REQUIRE( out.str() == "-2T_2(x) + 1" );
+
+    // Conversions long enough to be split recursively
+    auto p = random_polynomial<double>(150, 150, 45);
+    ChebyshevPolynomial<double> c(p);
+    double magnitude = 0;
+    for (auto &term : p)
+        magnitude += std::abs(term.second);
+    for (double x = -1; x <= 1; x += 0.125)
+        REQUIRE( std::abs(c(x) - p(x)) <= 1e-12 * magnitude );
+
+    std::vector<double> coefficients;
+    for (int k = 0; k < 150; ++k)
+        coefficients.push_back(std::sin(k + 1.0));
+    ChebyshevPolynomial<double> q(coefficients);
+    std::vector<long double> previous(150, 0), current(150, 0), reference(150, 0);
+    current[0] = 1;
+    reference[0] = coefficients[0];
+    for (size_t k = 1; k < 150; ++k) {
+        std::vector<long double> next(150, 0);
+        for (size_t j = 0; j <= k; ++j)
+            next[j] = (j > 0 ? (k == 1 ? 1 : 2) * current[j - 1] : 0) - (k == 1 ? 0 : previous[j]);
+        for (size_t j = 0; j <= k; ++j)
+            reference[j] += coefficients[k] * next[j];
+        previous = current;
+        current = next;
+    }
+    long double largest = 0;
+    for (auto r : reference)
+        largest = std::max(largest, std::abs(r));
+    auto monomial = q.to_polynomial();
+    for (unsigned j = 0; j < 150; ++j)
+        REQUIRE( std::abs(monomial.coefficient(j) - reference[j]) <= 1e-12 * largest );
+
+    // Products through the FFT match the direct formula
+    ChebyshevPolynomial<double> r(std::vector<double>(coefficients.begin(), coefficients.begin() + 100));
+    auto product = q * r;
+    REQUIRE( product.degree() == 248 );
+    for (unsigned k = 0; k <= 248; ++k) {
+        double expected = 0;
+        for (unsigned i = 0; i < 150; ++i) {
+            for (unsigned j = 0; j < 100; ++j) {
+                if (i + j == k)
+                    expected += q.coefficient(i) * r.coefficient(j) / 2;
+                if ((i > j ? i - j : j - i) == k)
+                    expected += q.coefficient(i) * r.coefficient(j) / 2;
+            }
+        }
+        REQUIRE( product.coefficient(k) == Approx(expected).margin(1e-10) );
+    }
+    REQUIRE( (t3 * t3 - ChebyshevPolynomial<double>(std::vector<double>{0.5, 0, 0, 0, 0, 0, 0.5})).length() == 0 );
+
+    // Calculus in the basis
+    auto small = random_polynomial<double>(8, 10, 46);
+    ChebyshevPolynomial<double> s(small);
+    auto derivative = s.differentiate(), expected = ChebyshevPolynomial<double>(small.differentiate());
+    for (unsigned k = 0; k < 10; ++k)
+        REQUIRE( derivative.coefficient(k) == Approx(expected.coefficient(k)).margin(1e-12) );
+    auto integral = s.integrate();
+    REQUIRE( integral(-1.0) == Approx(0).margin(1e-12) );
+    for (unsigned k = 0; k < 10; ++k)
+        REQUIRE( integral.differentiate().coefficient(k) == Approx(s.coefficient(k)).margin(1e-12) );
+    REQUIRE( ChebyshevPolynomial<double>(1.0).integrate()(1.0) == Approx(2) );
+
+    // Interpolation through a DCT of a length that isn't a power of two
+    auto e = ChebyshevPolynomial<double>::interpolate([](double x) { return std::exp(x); }, 14);
+    REQUIRE( e.degree() == 14 );
+    for (double x = -1; x <= 1; x += 0.01)
+        REQUIRE( std::abs(e(x) - std::exp(x)) < 1e-13 );
+
+    // Batch evaluation
+    std::vector<double> points, values(200);
+    for (int i = 0; i < 200; ++i)
+        points.push_back(-1 + i / 100.0);
+    q.evaluate(points.data(), points.size(), values.data());
+    for (size_t i = 0; i < points.size(); ++i)
+        REQUIRE( values[i] == Approx(q(points[i])) );
+}
+
+TEST_CASE( "Minimax approximation" ) {
+    // The best linear approximation of x^2 on [0, 1] is x - 1/8
+    auto square = remez([](double x) { return x * x; }, 1, 0.0, 1.0);
+    REQUIRE( square.converged );
+    REQUIRE( square.polynomial.coefficient(1) == Approx(1) );
+    REQUIRE( square.polynomial.coefficient(0) == Approx(-0.125) );
+    REQUIRE( square.max_error == Approx(0.125) );
+    REQUIRE( square.reference.size() == 3 );
+
+    // exp on [0, 1], against the Chebyshev interpolant of the same degree
+    auto exp = [](double x) { return std::exp(x); };
+    auto approximation = remez(exp, 6, 0.0, 1.0);
+    REQUIRE( approximation.converged );
+    REQUIRE( approximation.polynomial.degree() == 6 );
+    REQUIRE( approximation.max_error <= approximation.levelled_error * (1 + 1e-5) );
+    double interpolation_error = 0;
+    auto interpolant = ChebyshevPolynomial<double>::interpolate([](double t) { return std::exp((t + 1) / 2); }, 6);
+    for (double x = 0; x <= 1; x += 1.0 / 1024)
+        interpolation_error = std::max(interpolation_error, std::abs(interpolant(2 * x - 1) - std::exp(x)));
+    REQUIRE( approximation.max_error < interpolation_error );
+    REQUIRE( approximation.max_error < 5e-8 );
+
+    // The error equioscillates on the reference
+    const auto &reference = approximation.reference;
+    REQUIRE( reference.size() == 8 );
+    for (size_t i = 0; i < reference.size(); ++i) {
+        double e = std::exp(reference[i]) - approximation.polynomial(reference[i]);
+        REQUIRE( std::abs(e) == Approx(approximation.levelled_error).epsilon(1e-4) );
+        if (i > 0)
+            REQUIRE( (e > 0) != (std::exp(reference[i - 1]) - approximation.polynomial(reference[i - 1]) > 0) );
+    }
+
+    // Relative error, and a drop-in StaticPolynomial
+    RemezOptions options;
+    options.relative = true;
+    auto relative = remez(exp, 8, -1.0, 1.0, options);
+    REQUIRE( relative.converged );
+    auto fixed = relative.static_polynomial<9>();
+    for (double x = -1; x <= 1; x += 0.01)
+        REQUIRE( std::abs(fixed(x) - std::exp(x)) <= 1.01 * relative.max_error * std::exp(x) );
+    REQUIRE_THROWS_AS( relative.static_polynomial<8>(), std::length_error );
+
+    // Polynomials are reproduced
+    auto cubic = remez([](double x) { return 1 - 2 * x + x * x * x; }, 5, -2.0, 3.0);
+    REQUIRE( cubic.converged );
+    REQUIRE( cubic.max_error < 1e-12 );
+
+    REQUIRE_THROWS_AS( remez(exp, 3, 1.0, 1.0), std::invalid_argument );
+
+    // The coefficient table round-trips
+    REQUIRE( coefficient_table(Polynomial<double>({{0,1},{2,0.125}}), "c") ==
+             "static const double c[3] = {1.0, 0.0, 0.125};\n" );
+    REQUIRE( coefficient_table(Polynomial<float>({{1,0.5f}}), "c") == "static const float c[2] = {0.0f, 0.5f};\n" );
+    REQUIRE_THROWS_AS( coefficient_table(Polynomial<double>({{1,std::numeric_limits<double>::infinity()}}), "c"),
+                       std::invalid_argument );
+    REQUIRE_THROWS_AS( coefficient_table(Polynomial<float>({{0,std::numeric_limits<float>::quiet_NaN()}}), "c"),
+                       std::invalid_argument );
+    std::string table = coefficient_table(approximation.polynomial, "exp_coefficients");
+    std::istringstream in(table.substr(table.find('{') + 1));
+    for (unsigned k = 0; k <= 6; ++k) {
+        double c;
+        char separator;
+        in >> c >> separator;
+        REQUIRE( c == approximation.polynomial.coefficient(k) );
+    }
+}
+
+TEST_CASE( "Least-squares fitting" ) {
+    // Line through four points: y = 1.1 + 1.1x with residual 2.7
+    auto line = fit<double>({0, 1, 2, 3}, {1, 3, 2, 5}, 1);
+    REQUIRE( line.samples == 4 );
+    REQUIRE( line.polynomial().coefficient(0) == Approx(1.1) );
+    REQUIRE( line.polynomial().coefficient(1) == Approx(1.1) );
+    REQUIRE( line.residual == Approx(2.7) );
+    REQUIRE( line(1.5) == Approx(2.75) );
+
+    // Exact data is reproduced, far from [-1, 1] too
+    std::vector<double> xs, ys;
+    Polynomial<double> cubic({{0,3},{1,-2},{3,0.5}});
+    for (int i = 0; i < 1000; ++i) {
+        xs.push_back(100 + i / 100.0);
+        ys.push_back(cubic(xs.back() - 100));
+    }
+    auto exact = fit(xs, ys, 3);
+    REQUIRE( exact.residual < 1e-18 );
+    for (double x : {100.0, 103.3, 109.99})
+        REQUIRE( exact(x) == Approx(cubic(x - 100)) );
+
+    // Zero weights drop samples
+    std::vector<double> weights(xs.size(), 1.0);
+    ys[500] += 1000;
+    weights[500] = 0;
+    REQUIRE( fit(xs, ys, 3, weights).residual < 1e-18 );
+    weights[500] = -1;
+    REQUIRE_THROWS_AS( fit(xs, ys, 3, weights), std::invalid_argument );
+    REQUIRE_THROWS_AS( fit(xs, std::vector<double>(3), 3), std::invalid_argument );
+    REQUIRE_THROWS_AS( fit<double>({1, 2, 3}, {1, 2, 3}, 3), std::runtime_error );
+    REQUIRE( fit<double>({2, 2}, {1, 3}, 0)(2.0) == Approx(2) );
+
+    // Chunks fitted on several threads give the same result as one thread
+    std::mt19937 rng(47);
+    std::normal_distribution<double> noise(0, 0.1);
+    std::uniform_real_distribution<double> uniform(-2, 3);
+    xs.clear();
+    ys.clear();
+    for (int i = 0; i < 300000; ++i) {
+        xs.push_back(uniform(rng));
+        ys.push_back(std::sin(xs.back()) + noise(rng));
+    }
+    auto serial = fit(xs, ys, 7, {}, 1);
+    auto parallel = fit(xs, ys, 7, {}, 4);
+    ThreadPool pool(3);
+    auto pooled = fit(xs, ys, 7, {}, pool);
+    REQUIRE( serial.chebyshev == parallel.chebyshev );
+    REQUIRE( serial.chebyshev == pooled.chebyshev );
+    REQUIRE( serial.residual / xs.size() == Approx(0.01).epsilon(0.05) );
+    for (double x = -2; x <= 3; x += 0.25)
+        REQUIRE( std::abs(serial(x) - std::sin(x)) < 0.01 );
+
+    // Single pass over chunks in bounded memory, matching the in-memory fit
+    PolynomialFitter<double> fitter(7, serial.lower, serial.upper);
+    for (size_t first = 0; first < xs.size(); first += 1000)
+        fitter.add(xs.data() + first, ys.data() + first, std::min<size_t>(1000, xs.size() - first));
+    auto streamed = fitter.result();
+    REQUIRE( streamed.samples == xs.size() );
+    REQUIRE( streamed.residual == Approx(serial.residual) );
+    for (unsigned k = 0; k <= 7; ++k)
+        REQUIRE( streamed.chebyshev.coefficient(k) == Approx(serial.chebyshev.coefficient(k)).margin(1e-12) );
+}
+
+TEST_CASE( "Piecewise polynomials" ) {
+    // Cubic Hermite interpolant of sin on 1000 segments
+    const size_t n = 1000;
+    std::vector<double> knots;
+    std::vector<Polynomial<double>> pieces;
+    for (size_t i = 0; i <= n; ++i)
+        knots.push_back(0.01 * i + (i % 3 == 1 ? 0.003 : 0));
+    for (size_t i = 0; i < n; ++i) {
+        double h = knots[i + 1] - knots[i];
+        double y0 = std::sin(knots[i]), y1 = std::sin(knots[i + 1]);
+        double d0 = std::cos(knots[i]), d1 = std::cos(knots[i + 1]);
+        double c2 = (3 * (y1 - y0) / h - 2 * d0 - d1) / h, c3 = (d0 + d1 - 2 * (y1 - y0) / h) / (h * h);
+        pieces.push_back(Polynomial<double>({{0,y0},{1,d0},{2,c2},{3,c3}}));
+    }
+    PiecewisePolynomial<double> spline(knots, pieces);
+    REQUIRE( spline.segments() == n );
+    REQUIRE( spline.segment(7) == pieces[7] );
+
+    // Segments are found at and between the breakpoints
+    for (size_t i = 0; i < n; ++i) {
+        REQUIRE( spline.find_segment(knots[i]) == i );
+        REQUIRE( spline.find_segment((knots[i] + knots[i + 1]) / 2) == i );
+    }
+    REQUIRE( spline.find_segment(-5) == 0 );
+    REQUIRE( spline.find_segment(knots[n]) == n - 1 );
+    REQUIRE( spline.find_segment(100) == n - 1 );
+
+    // Batches in random and ascending order match the scalar evaluation
+    std::mt19937 rng(48);
+    std::uniform_real_distribution<double> uniform(-0.5, 10.5);
+    std::vector<double> points(3000), values(3000);
+    for (auto &x : points)
+        x = uniform(rng);
+    spline.evaluate(points.data(), points.size(), values.data());
+    for (size_t i = 0; i < points.size(); ++i) {
+        REQUIRE( values[i] == spline(points[i]) );
+        if (points[i] >= 0 && points[i] <= knots[n])
+            REQUIRE( std::abs(values[i] - std::sin(points[i])) < 1e-8 );
+    }
+    std::sort(points.begin(), points.end());
+    points.resize(2900);
+    points.push_back(1.0);
+    spline.evaluate_sorted(points.data(), points.size(), values.data());
+    for (size_t i = 0; i < points.size(); ++i)
+        REQUIRE( values[i] == spline(points[i]) );
+
+    // Pieces given in x, and derivatives
+    std::vector<Polynomial<double>> global;
+    Polynomial<double> x(std::map<unsigned,double>({{1,1}}));
+    global.push_back(x * x);
+    global.push_back(Polynomial<double>(2) * x - Polynomial<double>(1));
+    PiecewisePolynomial<double> joined({0, 1, 3}, global, PieceVariable::global);
+    REQUIRE( joined(0.5) == Approx(0.25) );
+    REQUIRE( joined(2.0) == Approx(3) );
+    REQUIRE( joined.segment(1) == Polynomial<double>({{0,1},{1,2}}) );
+    auto slope = joined.differentiate();
+    REQUIRE( slope(0.25) == Approx(0.5) );
+    REQUIRE( slope(2.5) == Approx(2) );
+
+    REQUIRE_THROWS_AS( PiecewisePolynomial<double>({0, 1}, global), std::invalid_argument );
+    REQUIRE_THROWS_AS( PiecewisePolynomial<double>({0, 2, 1}, global), std::invalid_argument );
+}
+
+TEST_CASE( "Multivariate polynomials" ) {
+    typedef MultiPolynomial<int, 3> P3;
+    P3 x = P3::Variable(0), y = P3::Variable(1), z = P3::Variable(2);
+    P3 square = (x + y) * (x + y);
+    REQUIRE( square == P3({{{2, 0, 0}, 1}, {{1, 1, 0}, 2}, {{0, 2, 0}, 1}}) );
+    REQUIRE( square.coefficient({1, 1, 0}) == 2 );
+    REQUIRE( square.degree() == 2 );
+    REQUIRE( (square - x * x - y * y - P3(2) * x * y).length() == 0 );
+    REQUIRE( (x - x).length() == 0 );
+
+    std::ostringstream out;
+    out << square - P3(3) * z + P3(1);
+    REQUIRE( out.str() == "1x^2 + 2xy + 1y^2 - 3z + 1" );
+
+    // Heap products against accumulating every pair of terms
+    std::mt19937 rng(49);
+    std::uniform_int_distribution<unsigned> exponent(0, 6);
+    std::uniform_int_distribution<int> coefficient(-9, 9);
+    P3 p, q;
+    for (int i = 0; i < 40; ++i) {
+        p.add_term({exponent(rng), exponent(rng), exponent(rng)}, coefficient(rng));
+        q.add_term({exponent(rng), exponent(rng), exponent(rng)}, coefficient(rng));
+    }
+    P3 expected;
+    for (auto &a : p) {
+        for (auto &b : q) {
+            auto e = a.exponents(), f = b.exponents();
+            expected.add_term({e[0] + f[0], e[1] + f[1], e[2] + f[2]}, a.coefficient * b.coefficient);
+        }
+    }
+    P3 product = p * q;
+    REQUIRE( product == expected );
+    REQUIRE( q * p == product );
+    REQUIRE( product(std::array<long long, 3>{2, -1, 3}) ==
+             p(std::array<long long, 3>{2, -1, 3}) * q(std::array<long long, 3>{2, -1, 3}) );
+
+    // Partial derivatives, and the product rule
+    P3 f = x * x * y + P3(3) * y * z;
+    REQUIRE( f.differentiate(0) == P3(2) * x * y );
+    REQUIRE( f.differentiate(1) == x * x + P3(3) * z );
+    REQUIRE( f.differentiate(2) == P3(3) * y );
+    REQUIRE( product.differentiate(1) == p.differentiate(1) * q + p * q.differentiate(1) );
+    REQUIRE_THROWS_AS( f.differentiate(3), std::out_of_range );
+
+    // One variable agrees with Polynomial
+    typedef MultiPolynomial<double, 1> P1;
+    auto u = random_polynomial<double>(20, 50, 49), v = random_polynomial<double>(20, 50, 50);
+    P1 mu, mv;
+    for (auto &term : u)
+        mu.add_term({term.first}, term.second);
+    for (auto &term : v)
+        mv.add_term({term.first}, term.second);
+    auto uv = u * v;
+    P1 muv = mu * mv;
+    REQUIRE( muv.length() == uv.length() );
+    for (auto &term : uv)
+        REQUIRE( muv.coefficient({term.first}) == Approx(term.second) );
+
+    // Exponent fields of eight variables hold up to 127
+    typedef MultiPolynomial<int, 8> P8;
+    REQUIRE( P8::max_exponent == 127 );
+    P8 high({{{127, 0, 0, 0, 0, 0, 0, 1}, 1}});
+    REQUIRE( high.coefficient({127, 0, 0, 0, 0, 0, 0, 1}) == 1 );
+    REQUIRE_THROWS_AS( P8({{{128, 0, 0, 0, 0, 0, 0, 0}, 1}}), std::overflow_error );
+    REQUIRE_THROWS_AS( high * high, std::overflow_error );
+    REQUIRE( (high * P8::Variable(7)).coefficient({127, 0, 0, 0, 0, 0, 0, 2}) == 1 );
+}
+
+TEST_CASE( "Polynomial matrices" ) {
+    // Products through transforms against the sum of entrywise products
+    auto classical = [](const auto &a, const auto &b) {
+        std::decay_t<decltype(a)> result(a.rows(), b.cols());
+        for (size_t i = 0; i < a.rows(); ++i)
+            for (size_t j = 0; j < b.cols(); ++j)
+                for (size_t k = 0; k < a.cols(); ++k)
+                    result(i, j) += a(i, k) * b(k, j);
+        return result;
+    };
+
+    PolynomialMatrix<int> a(3, 4), b(4, 2);
+    for (size_t i = 0; i < 3; ++i)
+        for (size_t k = 0; k < 4; ++k)
+            a(i, k) = random_polynomial<int>(60, 64, unsigned(10 * i + k));
+    for (size_t k = 0; k < 4; ++k)
+        for (size_t j = 0; j < 2; ++j)
+            b(k, j) = random_polynomial<int>(50, 64, unsigned(100 + 10 * k + j));
+    auto product = a * b;
+    REQUIRE( product.rows() == 3 );
+    REQUIRE( product.cols() == 2 );
+    REQUIRE( product == classical(a, b) );
+    REQUIRE( PolynomialMatrix<int>::identity(3) * a == a );
+    REQUIRE( a * PolynomialMatrix<int>::identity(4) == a );
+    REQUIRE_THROWS_AS( a * a, std::invalid_argument );
+    REQUIRE_THROWS_AS( a + b, std::invalid_argument );
+    REQUIRE( (a + a - a) == a );
+
+    // Coefficients too large for the two primes fall back to exact products
+    PolynomialMatrix<long long> big(2, 2);
+    for (size_t e = 0; e < 4; ++e) {
+        auto p = random_polynomial<long long>(60, 64, unsigned(200 + e));
+        for (auto &term : p)
+            big(e / 2, e % 2).add_term(term.first, term.second * 1000000000LL);
+    }
+    REQUIRE( big * big == classical(big, big) );
+
+    PolynomialMatrix<double> x(2, 3), y(3, 3);
+    for (size_t e = 0; e < 6; ++e)
+        x(e / 3, e % 3) = random_polynomial<double>(100, 128, unsigned(300 + e));
+    for (size_t e = 0; e < 9; ++e)
+        y(e / 3, e % 3) = random_polynomial<double>(100, 128, unsigned(400 + e));
+    auto xy = x * y, expected = classical(x, y);
+    for (size_t i = 0; i < 2; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+            REQUIRE( xy(i, j).length() == expected(i, j).length() );
+            for (auto &term : expected(i, j))
+                REQUIRE( xy(i, j).coefficient(term.first) == Approx(term.second) );
+        }
+    }
+
+    // Sparse entries of high degree are multiplied entrywise
+    PolynomialMatrix<double> sparse{{Polynomial<double>(std::map<unsigned, double>({{100000, 2.0}})), 1.0},
+                                    {0.0, Polynomial<double>::LinearTerm()}};
+    auto square = sparse * sparse;
+    REQUIRE( square(0, 0) == Polynomial<double>(std::map<unsigned, double>({{200000, 4.0}})) );
+    REQUIRE( square(0, 1) == Polynomial<double>(std::map<unsigned, double>({{1, 1.0}, {100000, 2.0}})) );
+    REQUIRE( square(1, 1) == Polynomial<double>(std::map<unsigned, double>({{2, 1.0}})) );
+}
+
+#ifdef POLYNOMIAL_INSTRUMENTATION
+TEST_CASE( "Operation counters" ) {
+    auto p = random_polynomial<int>(20, 40, 14);
+    auto q = random_polynomial<int>(10, 40, 15);
+    polynomial_stats_reset();
+
+    auto product = p * q;
+    auto sum = p + q;
+    auto derivative = p.differentiate();
+    p(2);
+    p(3);
+
+    auto stats = polynomial_stats_snapshot();
+    REQUIRE( stats[PolynomialOperation::Multiply].calls == 1 );
+    REQUIRE( stats[PolynomialOperation::Multiply].terms == 30 );
+    REQUIRE( stats[PolynomialOperation::Multiply].allocations >= product.length() );
+    REQUIRE( stats[PolynomialOperation::Add].calls == 1 );
+    REQUIRE( stats[PolynomialOperation::Add].allocations >= sum.length() );
+    REQUIRE( stats[PolynomialOperation::Differentiate].calls == 1 );
+    REQUIRE( stats[PolynomialOperation::Differentiate].allocations == derivative.length() );
+    REQUIRE( stats[PolynomialOperation::Evaluate].calls == 2 );
+    REQUIRE( stats[PolynomialOperation::Evaluate].terms == 40 );
+    REQUIRE( std::string(operation_name(PolynomialOperation::Evaluate)) == "operator()" );
+
+    // Counters of other threads are included, also after they exit
+    std::thread([&]() { p.differentiate(); }).join();
+    REQUIRE( polynomial_stats_snapshot()[PolynomialOperation::Differentiate].calls == 2 );
+
+    polynomial_stats_reset();
+    REQUIRE( polynomial_stats_snapshot()[PolynomialOperation::Multiply].calls == 0 );
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,216 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a task queue: it takes work
+// from the back of its own queue and, once that runs dry, steals from the
+// front of the other workers' queues. Queues have their own locks so
+// workers only contend when stealing.
+//
+// Every worker also owns a pool memory resource for what its tasks
+// allocate, so workers don't share an allocator lock. Memory from these
+// resources is released with the pool: anything allocated from them must
+// be destroyed before the ThreadPool.
+class ThreadPool {
+ private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // Identifies the pool and queue of the calling thread, if it is a worker
+    struct WorkerId {
+        const ThreadPool *pool = nullptr;
+        size_t index = 0;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    // One per worker, and a last one for threads outside the pool
+    std::vector<std::unique_ptr<std::pmr::synchronized_pool_resource>> resources;
+
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> sleepers{0};
+    std::atomic<size_t> next_queue{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+
+    static WorkerId &this_worker() {
+        static thread_local WorkerId id;
+        return id;
+    }
+
+    bool pop(size_t index, std::function<void()> &task) {
+        Queue &queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            return false;
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(size_t thief, std::function<void()> &task) {
+        for (size_t i = 1; i <= queues.size(); ++i) {
+            Queue &queue = *queues[(thief + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Run one queued task on the calling thread, returns false if there
+    // was nothing to do
+    bool run_one() {
+        WorkerId &id = this_worker();
+        bool is_worker = id.pool == this;
+        size_t index = is_worker ? id.index : next_queue.load() % queues.size();
+
+        std::function<void()> task;
+        if ((is_worker && pop(index, task)) || steal(index, task)) {
+            pending--;
+            task();
+            return true;
+        }
+        return false;
+    }
+
+    void work(size_t index) {
+        this_worker() = {this, index};
+        while (true) {
+            if (run_one())
+                continue;
+
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            sleepers++;
+            wake.wait(lock, [this]() { return pending > 0 || stopping; });
+            sleepers--;
+            if (stopping && pending == 0)
+                return;
+        }
+    }
+
+ public:
+    // Worker resources take their memory from `upstream`
+    explicit ThreadPool(unsigned n_threads = std::thread::hardware_concurrency(),
+                        std::pmr::memory_resource *upstream = std::pmr::get_default_resource()) {
+        n_threads = std::max(1u, n_threads);
+        for (unsigned i = 0; i < n_threads; ++i)
+            queues.emplace_back(new Queue());
+        for (unsigned i = 0; i <= n_threads; ++i)
+            resources.emplace_back(new std::pmr::synchronized_pool_resource(upstream));
+        for (unsigned i = 0; i < n_threads; ++i)
+            threads.emplace_back(&ThreadPool::work, this, i);
+    }
+
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool &operator= (ThreadPool const &) = delete;
+
+    // Finishes all queued tasks before joining the workers
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+    size_t size() const {
+        return threads.size();
+    }
+
+    // Memory resource of the calling thread: its own on a worker, and one
+    // shared by all other threads. Memory may be freed from any thread.
+    std::pmr::memory_resource *worker_resource() {
+        WorkerId &id = this_worker();
+        return resources[id.pool == this ? id.index : threads.size()].get();
+    }
+
+    // Queue a task. Tasks submitted from a worker go to that worker's own
+    // queue, other submissions are spread over the queues round-robin.
+    template<typename F>
+    void submit(F &&task) {
+        WorkerId &id = this_worker();
+        size_t index = id.pool == this ? id.index : next_queue++ % queues.size();
+        {
+            Queue &queue = *queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.emplace_back(std::forward<F>(task));
+        }
+        pending++;
+
+        // Only touch the shared lock when a worker may be asleep
+        if (sleepers > 0) {
+            { std::lock_guard<std::mutex> lock(sleep_mutex); }
+            wake.notify_one();
+        }
+    }
+
+    // Call task(i) for every i in [0, count) and wait for all calls to
+    // finish. Indices are handed out in chunks of `grain`, 0 picks a chunk
+    // size giving each worker several chunks. The calling thread helps with
+    // the work until the queues are empty and then sleeps until the last
+    // chunk finishes or more work is queued, so this may also be called
+    // from inside a task. The first exception thrown by a task is rethrown
+    // here.
+    template<typename Task>
+    void parallel_for(size_t count, Task task, size_t grain = 0) {
+        if (count == 0)
+            return;
+        if (grain == 0)
+            grain = std::max<size_t>(1, count / (8 * size()));
+
+        size_t n_chunks = (count + grain - 1) / grain;
+        std::atomic<size_t> remaining(n_chunks);
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        for (size_t chunk = 0; chunk < n_chunks; ++chunk) {
+            submit([&, chunk]() {
+                try {
+                    size_t end = std::min(count, (chunk + 1) * grain);
+                    for (size_t i = chunk * grain; i < end; ++i)
+                        task(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+                if (--remaining == 0) {
+                    std::lock_guard<std::mutex> lock(sleep_mutex);
+                    wake.notify_all();
+                }
+            });
+        }
+
+        while (remaining > 0) {
+            if (run_one())
+                continue;
+
+            // Sleep like an idle worker, so submit() wakes us for new tasks
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            sleepers++;
+            wake.wait(lock, [&]() { return remaining == 0 || pending > 0; });
+            sleepers--;
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+};